@@ -0,0 +1,242 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include "asset_pack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char ASSET_PACK_MAGIC[4] = { 'B', 'P', 'A', 'K' };
+
+static_assert(sizeof(AssetPackHeader) == 32, "pack header layout");
+static_assert(sizeof(AssetPackEntry) == 32, "pack entry layout");
+
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& file)
+    : Data(nullptr), Size(0), file(INVALID_HANDLE_VALUE), mapping(nullptr)
+{
+    this->file = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER size;
+    if (this->file == INVALID_HANDLE_VALUE || !GetFileSizeEx(this->file, &size) || size.QuadPart == 0)
+        return;
+    this->mapping = CreateFileMappingA(this->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!this->mapping)
+        return;
+    this->Data = static_cast<const char*>(MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0));
+    if (this->Data)
+        this->Size = static_cast<size_t>(size.QuadPart);
+}
+
+MappedFile::~MappedFile()
+{
+    if (this->Data)
+        UnmapViewOfFile(this->Data);
+    if (this->mapping)
+        CloseHandle(this->mapping);
+    if (this->file != INVALID_HANDLE_VALUE)
+        CloseHandle(this->file);
+}
+#else
+MappedFile::MappedFile(const std::string& file)
+    : Data(nullptr), Size(0)
+{
+    int descriptor = open(file.c_str(), O_RDONLY);
+    if (descriptor < 0)
+        return;
+    struct stat info;
+    if (fstat(descriptor, &info) == 0 && info.st_size > 0)
+    {
+        void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (data != MAP_FAILED)
+        {
+            this->Data = static_cast<const char*>(data);
+            this->Size = static_cast<size_t>(info.st_size);
+        }
+    }
+    close(descriptor); // the mapping keeps the file alive
+}
+
+MappedFile::~MappedFile()
+{
+    if (this->Data)
+        munmap(const_cast<char*>(this->Data), this->Size);
+}
+#endif
+
+PackMount::PackMount(const std::string& file)
+    : mapped(file), entries(nullptr), entryCount(0), names(nullptr)
+{
+    // check everything the lookups rely on once, so they never read outside the mapping
+    const AssetPackHeader* header = reinterpret_cast<const AssetPackHeader*>(this->mapped.Data);
+    bool valid = this->mapped.Size >= sizeof(AssetPackHeader)
+        && std::memcmp(header->Magic, ASSET_PACK_MAGIC, 4) == 0 && header->Version == ASSET_PACK_VERSION
+        && sizeof(AssetPackHeader) + static_cast<uint64_t>(header->EntryCount) * sizeof(AssetPackEntry) <= header->NamesOffset
+        && header->NamesOffset <= this->mapped.Size && header->NamesSize <= this->mapped.Size - header->NamesOffset;
+    const AssetPackEntry* entries = valid ? reinterpret_cast<const AssetPackEntry*>(this->mapped.Data + sizeof(AssetPackHeader)) : nullptr;
+    for (uint32_t i = 0; valid && i < header->EntryCount; ++i)
+        valid = entries[i].Offset <= this->mapped.Size && entries[i].Size <= this->mapped.Size - entries[i].Offset
+            && static_cast<uint64_t>(entries[i].NameOffset) + entries[i].NameLength <= header->NamesSize;
+    if (!valid)
+    {
+        std::cout << "ERROR::PACK: " << file << " is missing or not an asset pack" << std::endl;
+        return;
+    }
+    this->entries = entries;
+    this->entryCount = header->EntryCount;
+    this->names = this->mapped.Data + header->NamesOffset;
+}
+
+bool PackMount::Exists(const std::string& path) const
+{
+    return this->find(path) != nullptr;
+}
+
+bool PackMount::Read(const std::string& path, std::vector<char>& data) const
+{
+    FileView view;
+    if (!this->View(path, view))
+        return false;
+    data.assign(view.begin(), view.end());
+    return true;
+}
+
+bool PackMount::View(const std::string& path, FileView& view) const
+{
+    const AssetPackEntry* entry = this->find(path);
+    if (!entry)
+        return false;
+    view.Data = this->mapped.Data + entry->Offset;
+    view.Size = static_cast<size_t>(entry->Size);
+    return true;
+}
+
+const AssetPackEntry* PackMount::find(const std::string& path) const
+{
+    const AssetPackEntry* end = this->entries + this->entryCount;
+    const AssetPackEntry* entry = std::lower_bound(this->entries, end, path, [this](const AssetPackEntry& entry, const std::string& path) {
+        return path.compare(0, std::string::npos, this->names + entry.NameOffset, entry.NameLength) > 0;
+    });
+    if (entry == end || path.compare(0, std::string::npos, this->names + entry->NameOffset, entry->NameLength) != 0)
+        return nullptr;
+    return entry;
+}
+
+bool ListFiles(const std::string& directory, std::vector<std::string>& files)
+{
+#ifdef _WIN32
+    WIN32_FIND_DATAA found;
+    HANDLE search = FindFirstFileA((directory + "/*").c_str(), &found);
+    if (search == INVALID_HANDLE_VALUE)
+        return false;
+    do
+    {
+        if (!(found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+            files.push_back(found.cFileName);
+    } while (FindNextFileA(search, &found));
+    FindClose(search);
+    return true;
+#else
+    DIR* dir = opendir(directory.c_str());
+    if (!dir)
+        return false;
+    while (dirent* found = readdir(dir))
+    {
+        struct stat info;
+        if (stat((directory + "/" + found->d_name).c_str(), &info) == 0 && S_ISREG(info.st_mode))
+            files.push_back(found->d_name);
+    }
+    closedir(dir);
+    return true;
+#endif
+}
+
+static uint64_t alignPack(uint64_t value)
+{
+    return (value + ASSET_PACK_ALIGNMENT - 1) / ASSET_PACK_ALIGNMENT * ASSET_PACK_ALIGNMENT;
+}
+
+int BuildAssetPack(const std::string& root, const std::vector<std::string>& folders, const std::string& output)
+{
+    // gather the logical paths, sorted so the table of contents can be binary searched
+    std::vector<std::string> paths;
+    for (const std::string& folder : folders)
+    {
+        std::vector<std::string> files;
+        if (!ListFiles(root + "/" + folder, files))
+        {
+            std::cout << "ERROR::PACK: Failed to list " << root << "/" << folder << std::endl;
+            return -1;
+        }
+        for (const std::string& file : files)
+            paths.push_back(folder + "/" + file);
+    }
+    std::sort(paths.begin(), paths.end());
+
+    // lay out the table of contents and the paths, then the data of every file
+    AssetPackHeader header = AssetPackHeader();
+    std::memcpy(header.Magic, ASSET_PACK_MAGIC, 4);
+    header.Version = ASSET_PACK_VERSION;
+    header.EntryCount = static_cast<uint32_t>(paths.size());
+    header.NamesOffset = sizeof(AssetPackHeader) + paths.size() * sizeof(AssetPackEntry);
+    std::vector<AssetPackEntry> entries(paths.size(), AssetPackEntry());
+    std::string names;
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        entries[i].NameOffset = static_cast<uint32_t>(names.size());
+        entries[i].NameLength = static_cast<uint32_t>(paths[i].size());
+        names += paths[i];
+    }
+    header.NamesSize = names.size();
+    std::vector<std::vector<char>> contents(paths.size());
+    uint64_t offset = alignPack(header.NamesOffset + header.NamesSize);
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        DirectoryMount source(root);
+        if (!source.Read(paths[i], contents[i]))
+        {
+            std::cout << "ERROR::PACK: Failed to read " << root << "/" << paths[i] << std::endl;
+            return -1;
+        }
+        entries[i].Offset = offset;
+        entries[i].Size = contents[i].size();
+        offset = alignPack(offset + contents[i].size());
+    }
+
+    std::ofstream out(output, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(AssetPackEntry));
+    out.write(names.data(), names.size());
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        // pad up to the file's aligned offset
+        std::vector<char> padding(static_cast<size_t>(entries[i].Offset - static_cast<uint64_t>(out.tellp())), 0);
+        out.write(padding.data(), padding.size());
+        out.write(contents[i].data(), contents[i].size());
+    }
+    if (!out)
+    {
+        std::cout << "ERROR::PACK: Failed to write " << output << std::endl;
+        return -1;
+    }
+    return static_cast<int>(paths.size());
+}
@@ -0,0 +1,93 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "file_system.h"
+
+
+// Pack file layout (little-endian): a header, the table of contents
+// (one entry per file, sorted by path), the paths, then the file data.
+// Header and entries are 32 bytes and every file starts at a multiple
+// of ASSET_PACK_ALIGNMENT, so a mapped pack can be used in place.
+struct AssetPackHeader {
+    char     Magic[4];     // "BPAK"
+    uint32_t Version;
+    uint32_t EntryCount;
+    uint32_t Reserved;
+    uint64_t NamesOffset;  // start of the paths, which are not terminated
+    uint64_t NamesSize;
+};
+
+struct AssetPackEntry {
+    uint64_t Offset;       // of the file data, from the start of the pack
+    uint64_t Size;
+    uint32_t NameOffset;   // of the path, from NamesOffset
+    uint32_t NameLength;
+    uint64_t Reserved;
+};
+
+const uint32_t ASSET_PACK_VERSION = 1;
+const uint64_t ASSET_PACK_ALIGNMENT = 64;
+
+// Folders (relative to the source root) that go into a pack built with --build-pack
+const char* const ASSET_PACK_FOLDERS[] = { "textures", "shaders", "levels", "fonts", "audio" };
+
+
+// A file mapped read-only into memory
+class MappedFile
+{
+public:
+    // constructor/destructor; check Data for whether mapping worked
+    MappedFile(const std::string& file);
+    ~MappedFile();
+    const char* Data;
+    size_t      Size;
+private:
+    // the object owns the mapping
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+#ifdef _WIN32
+    void*       file;
+    void*       mapping;
+#endif
+};
+
+// An asset pack as a mount. The pack is memory-mapped, so views of its
+// files point straight into the mapping: nothing is copied or read
+// until the pages are touched.
+class PackMount : public FileMount
+{
+public:
+    // constructor (check Valid for whether the pack could be opened)
+    PackMount(const std::string& file);
+    bool Valid() const { return this->entries != nullptr; }
+    bool Exists(const std::string& path) const override;
+    bool Read(const std::string& path, std::vector<char>& data) const override;
+    bool View(const std::string& path, FileView& view) const override;
+private:
+    MappedFile            mapped;
+    const AssetPackEntry* entries;
+    unsigned int          entryCount;
+    const char*           names;
+    // binary search of the table of contents; nullptr if the pack doesn't hold the path
+    const AssetPackEntry* find(const std::string& path) const;
+};
+
+// appends the names of the regular files in a directory
+bool ListFiles(const std::string& directory, std::vector<std::string>& files);
+// writes a pack of every file in the given folders of root, stored under "folder/file";
+// returns the number of files packed, or -1 on failure
+int BuildAssetPack(const std::string& root, const std::vector<std::string>& folders, const std::string& output);
+
+#endif
@@ -12,7 +12,7 @@
 BallObject::BallObject()
     : GameObject(), Radius(12.5f), Stuck(true), Sticky(false), PassThrough(false) { }
 
-BallObject::BallObject(glm::vec2 pos, float radius, glm::vec2 velocity, Texture2D sprite)
+BallObject::BallObject(glm::vec2 pos, float radius, glm::vec2 velocity, TextureHandle sprite)
     : GameObject(pos, glm::vec2(radius * 2.0f, radius * 2.0f), sprite, glm::vec3(1.0f), velocity), Radius(radius), Stuck(true), Sticky(false), PassThrough(false) { }
 
 glm::vec2 BallObject::Move(float dt, unsigned int window_width)
@@ -13,13 +13,14 @@
 #include <glm/glm.hpp>
 
 #include "game_object.h"
-#include "texture.h"
 
 
 // BallObject holds the state of the Ball object inheriting
 // relevant state data from GameObject. Contains some extra
 // functionality specific to Breakout's ball object that
 // were too specific for within GameObject alone.
+// Power-up flags (Sticky, PassThrough) are per ball, so every
+// ball in play carries its own.
 class BallObject : public GameObject
 {
 public:
@@ -29,7 +30,7 @@ public:
     bool    Sticky, PassThrough;
     // constructor(s)
     BallObject();
-    BallObject(glm::vec2 pos, float radius, glm::vec2 velocity, Texture2D sprite);
+    BallObject(glm::vec2 pos, float radius, glm::vec2 velocity, TextureHandle sprite);
     // moves the ball, keeping it constrained within the window bounds (except bottom edge); returns new position
     glm::vec2 Move(float dt, unsigned int window_width);
     // resets the ball to original state with given position and velocity
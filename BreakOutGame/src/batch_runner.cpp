@@ -0,0 +1,97 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include "batch_runner.h"
+#include "headless_runner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+
+BatchRunner::BatchRunner(JobSystem& jobs, float dt, unsigned int maxTicks)
+    : Ticks(0), Seconds(0.0), jobs(jobs), dt(dt), maxTicks(maxTicks)
+{
+
+}
+
+void BatchRunner::Run(unsigned int games, unsigned int levelCount)
+{
+    this->Games.assign(games, BatchGame());
+    for (unsigned int i = 0; i < games; ++i)
+    {
+        this->Games[i].Level = i % std::max(levelCount, 1u);
+        this->Games[i].Seed = i; // results only depend on the game index, not on which thread played it
+    }
+    Game reference(800, 600);
+    reference.LoadLevels();
+    this->levels = reference.Levels;
+
+    std::atomic<unsigned long long> ticks(0);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    // every game is independent, so each one is a job of its own and results go straight into its slot
+    this->jobs.ParallelFor(games, [this, &ticks](unsigned int i) {
+        ticks += this->play(this->Games[i]);
+    });
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    this->Ticks = ticks;
+    this->Seconds = elapsed.count();
+}
+
+BatchStats BatchRunner::Aggregate(int level) const
+{
+    BatchStats stats = BatchStats();
+    double completionSeconds = 0.0, livesLost = 0.0, powerUps = 0.0, bricks = 0.0;
+    for (const BatchGame& game : this->Games)
+    {
+        if (level >= 0 && game.Level != static_cast<unsigned int>(level))
+            continue;
+        ++stats.Games;
+        livesLost += game.Stats.LivesLost;
+        powerUps += game.Stats.PowerUpsCollected;
+        bricks += game.Stats.BricksDestroyed;
+        if (game.Completed)
+        {
+            stats.MinCompletionSeconds = stats.Completed == 0 ? game.CompletionSeconds : std::min(stats.MinCompletionSeconds, static_cast<double>(game.CompletionSeconds));
+            stats.MaxCompletionSeconds = std::max(stats.MaxCompletionSeconds, static_cast<double>(game.CompletionSeconds));
+            completionSeconds += game.CompletionSeconds;
+            ++stats.Completed;
+        }
+    }
+    if (stats.Games > 0)
+    {
+        stats.MeanLivesLost = livesLost / stats.Games;
+        stats.MeanPowerUpsCollected = powerUps / stats.Games;
+        stats.MeanBricksDestroyed = bricks / stats.Games;
+    }
+    if (stats.Completed > 0)
+        stats.MeanCompletionSeconds = completionSeconds / stats.Completed;
+    return stats;
+}
+
+unsigned int BatchRunner::play(BatchGame& result)
+{
+    Game game(800, 600);
+    game.Headless = true;
+    game.Levels = this->levels;
+    game.Init();
+    game.Seed(result.Seed);
+    if (result.Level < game.Levels.size())
+        game.Level = result.Level;
+    HeadlessRunner runner(game, this->dt);
+    unsigned int tick = 0;
+    while (tick < this->maxTicks && game.Stats.LevelsCompleted == 0)
+    {
+        runner.Step();
+        ++tick;
+    }
+    result.Completed = game.Stats.LevelsCompleted > 0;
+    result.CompletionSeconds = tick * this->dt;
+    result.Stats = game.Stats;
+    return tick;
+}
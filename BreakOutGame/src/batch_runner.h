@@ -0,0 +1,67 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef BATCH_RUNNER_H
+#define BATCH_RUNNER_H
+
+#include <vector>
+
+#include "game.h"
+#include "job_system.h"
+
+
+// Outcome of a single game of a batch
+struct BatchGame {
+    unsigned int Level;             // level the game was played on
+    uint32_t     Seed;              // seed of the game's random streams
+    bool         Completed;         // cleared the level within the tick budget
+    float        CompletionSeconds; // simulated time until the level was cleared (or the budget ran out)
+    GameStats    Stats;
+};
+
+// Aggregate over a set of games of a batch
+struct BatchStats {
+    unsigned int Games;
+    unsigned int Completed;
+    double       MeanCompletionSeconds, MinCompletionSeconds, MaxCompletionSeconds; // over the completed games
+    double       MeanLivesLost;
+    double       MeanPowerUpsCollected;
+    double       MeanBricksDestroyed;
+};
+
+
+// BatchRunner plays many independent headless games at once for
+// level balancing. Every game gets its own Game instance driven by
+// the HeadlessRunner autopilot and runs as one job on the job
+// system, until it clears its level or runs out of ticks.
+class BatchRunner
+{
+public:
+    // results, indexed by game
+    std::vector<BatchGame> Games;
+    // totals of the last Run
+    unsigned long long     Ticks;
+    double                 Seconds;
+    // constructor
+    BatchRunner(JobSystem& jobs, float dt, unsigned int maxTicks);
+    // plays the given number of games; game i is played on level i % levelCount
+    void Run(unsigned int games, unsigned int levelCount = 4);
+    // aggregates the results of the last Run, for one level or for all of them when level is negative
+    BatchStats Aggregate(int level = -1) const;
+private:
+    // state
+    JobSystem&   jobs;
+    float        dt;
+    unsigned int maxTicks;
+    // the levels as parsed once per Run, copied into every game
+    std::vector<GameLevel> levels;
+    // plays one game to completion or the tick budget; returns the ticks stepped
+    unsigned int play(BatchGame& result);
+};
+
+#endif
@@ -0,0 +1,728 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include "benchmarks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <tuple>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "ball_object.h"
+#include "collision.h"
+#include "cooked_texture.h"
+#include "file_system.h"
+#include "frame_uniforms.h"
+#include "game.h"
+#include "game_level.h"
+#include "particle_generator.h"
+#include "random.h"
+#include "resource_manager.h"
+#include "sprite_renderer.h"
+#include "stb_image.h"
+#include "text_renderer.h"
+
+
+// small deterministic generator so every run measures the same workload
+static float nextRandom(uint32_t& state)
+{
+    state = state * 1664525u + 1013904223u;
+    return (state >> 8) / 16777216.0f;
+}
+
+// calls work(i) for increasing i until at least minSeconds have passed; returns calls per second
+template <typename Work>
+static double measure(Work work, double minSeconds = 1.0)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    unsigned long long calls = 0;
+    double elapsed = 0.0;
+    do
+    {
+        for (unsigned int i = 0; i < 16; ++i)
+            work(calls++);
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < minSeconds);
+    return calls / elapsed;
+}
+
+// fills a width x height level with a repeating mix of empty, solid and colored tiles
+static void generateTiles(unsigned int width, unsigned int height, std::vector<std::vector<unsigned int>>& tiles)
+{
+    tiles.assign(height, std::vector<unsigned int>(width, 0));
+    for (unsigned int y = 0; y < height; ++y)
+        for (unsigned int x = 0; x < width; ++x)
+            tiles[y][x] = (x * 7 + y * 13) % 6;
+}
+
+// number of live bricks in a level
+static unsigned int countBricks(const GameLevel& level)
+{
+    unsigned int bricks = 0;
+    for (unsigned int slot = 0; slot < level.SlotCount(); ++slot)
+        if (!level.IsDestroyed(slot))
+            ++bricks;
+    return bricks;
+}
+
+// a ball state to sweep against the level
+struct BallQuery {
+    glm::vec2 Center, Delta;
+};
+
+static void benchmarkBroadphase(unsigned int tilesX, unsigned int tilesY)
+{
+    // bricks keep their in-game size (40x20), so bigger levels cover more space
+    const float radius = 12.5f;
+    std::vector<std::vector<unsigned int>> tiles;
+    generateTiles(tilesX, tilesY, tiles);
+    GameLevel level;
+    level.LoadTiles(tiles, tilesX * 40, tilesY * 20);
+
+    // balls anywhere in the level, moving at in-game speeds for one 120 Hz step
+    const unsigned int queryCount = 4096;
+    std::vector<BallQuery> queries(queryCount);
+    uint32_t seed = 12345;
+    for (BallQuery& query : queries)
+    {
+        query.Center = glm::vec2(nextRandom(seed) * tilesX * 40, nextRandom(seed) * tilesY * 20);
+        float angle = nextRandom(seed) * 6.2831853f;
+        query.Delta = glm::vec2(std::cos(angle), std::sin(angle)) * (500.0f / 120.0f);
+    }
+
+    // before: test every brick in the level
+    std::vector<int> bruteHits(queryCount, -2);
+    double brute = measure([&](unsigned long long i) {
+        const BallQuery& query = queries[i % queryCount];
+        SweepHit hit;
+        float earliest = 2.0f;
+        int target = -1;
+        for (unsigned int b = 0; b < level.SlotCount(); ++b)
+        {
+            glm::vec2 brick = level.BrickPosition(b);
+            if (!level.IsDestroyed(b) && SweepCircleAABB(query.Center, radius, query.Delta, brick, brick + level.UnitSize, hit) && hit.Time < earliest)
+            {
+                earliest = hit.Time;
+                target = b;
+            }
+        }
+        bruteHits[i % queryCount] = target;
+    });
+
+    // after: only the bricks in the grid cells the swept ball overlaps
+    std::vector<int> gridHits(queryCount, -2);
+    std::vector<unsigned int> candidates;
+    double grid = measure([&](unsigned long long i) {
+        const BallQuery& query = queries[i % queryCount];
+        candidates.clear();
+        level.Query(query.Center + query.Delta * 0.5f, radius + glm::length(query.Delta) * 0.5f, candidates);
+        SweepHit hit;
+        float earliest = 2.0f;
+        int target = -1;
+        for (unsigned int b : candidates)
+        {
+            glm::vec2 brick = level.BrickPosition(b);
+            if (SweepCircleAABB(query.Center, radius, query.Delta, brick, brick + level.UnitSize, hit) && hit.Time < earliest)
+            {
+                earliest = hit.Time;
+                target = b;
+            }
+        }
+        gridHits[i % queryCount] = target;
+    });
+
+    // both paths must agree wherever both ran
+    unsigned int mismatches = 0;
+    for (unsigned int i = 0; i < queryCount; ++i)
+        if (bruteHits[i] != -2 && gridHits[i] != -2 && bruteHits[i] != gridHits[i])
+            ++mismatches;
+
+    std::cout << "broadphase " << tilesX << "x" << tilesY << " (" << countBricks(level) << " bricks): "
+        << "brute force " << brute << " queries/s, grid " << grid << " queries/s, speedup "
+        << grid / brute << "x, mismatches " << mismatches << std::endl;
+}
+
+// the circle-AABB test that Game::DoCollisions ran against every GameObject brick before
+// levels were stored as structure-of-arrays
+static bool checkCollision(const BallObject& one, const GameObject& two)
+{
+    glm::vec2 center(one.Position + one.Radius);
+    glm::vec2 aabb_half_extents(two.Size.x / 2.0f, two.Size.y / 2.0f);
+    glm::vec2 aabb_center(two.Position.x + aabb_half_extents.x, two.Position.y + aabb_half_extents.y);
+    glm::vec2 difference = center - aabb_center;
+    glm::vec2 clamped = glm::clamp(difference, -aabb_half_extents, aabb_half_extents);
+    glm::vec2 closest = aabb_center + clamped;
+    difference = closest - center;
+    return glm::length(difference) <= one.Radius;
+}
+
+static void benchmarkBricks(unsigned int tilesX, unsigned int tilesY)
+{
+    std::vector<std::vector<unsigned int>> tiles;
+    generateTiles(tilesX, tilesY, tiles);
+    GameLevel level;
+    level.LoadTiles(tiles, tilesX * 40, tilesY * 20);
+    // the same bricks as polymorphic GameObjects, the way levels used to hold them
+    std::vector<GameObject> objects;
+    for (unsigned int slot = 0; slot < level.SlotCount(); ++slot)
+    {
+        GameObject brick(level.BrickPosition(slot), level.UnitSize, TextureHandle());
+        brick.IsSolid = level.IsSolid(slot);
+        brick.Destroyed = level.IsDestroyed(slot);
+        objects.push_back(brick);
+    }
+    const unsigned int queryCount = 1024;
+    std::vector<glm::vec2> centers(queryCount);
+    uint32_t seed = 54321;
+    for (glm::vec2& center : centers)
+        center = glm::vec2(nextRandom(seed) * tilesX * 40, nextRandom(seed) * tilesY * 20);
+    BallObject ball(glm::vec2(0.0f), 12.5f, glm::vec2(0.0f), TextureHandle());
+    std::vector<unsigned int> hits(level.SlotCount());
+
+    // every pass tests one ball against every brick of the level
+    unsigned int objectHits = 0, scalarHits = 0, simdHits = 0;
+    double objectsPerSecond = measure([&](unsigned long long i) {
+        ball.Position = centers[i % queryCount] - ball.Radius;
+        for (const GameObject& box : objects)
+            if (!box.Destroyed && checkCollision(ball, box))
+                ++objectHits;
+    }) * level.SlotCount();
+    double scalarPerSecond = measure([&](unsigned long long i) {
+        scalarHits += OverlapCircleBricksScalar(level.BrickX.data(), level.BrickY.data(), level.DestroyedMask.data(),
+            0, level.SlotCount(), level.UnitSize, centers[i % queryCount], ball.Radius, hits.data());
+    }) * level.SlotCount();
+    double simdPerSecond = measure([&](unsigned long long i) {
+        simdHits += OverlapCircleBricks(level.BrickX.data(), level.BrickY.data(), level.DestroyedMask.data(),
+            0, level.SlotCount(), level.UnitSize, centers[i % queryCount], ball.Radius, hits.data());
+    }) * level.SlotCount();
+
+    std::cout << "bricks " << tilesX << "x" << tilesY << ": sizeof(GameObject) " << sizeof(GameObject)
+        << " bytes vs ~" << (2 * sizeof(float) + 1) << " bytes per slot; brick tests/s: GameObject loop " << objectsPerSecond
+        << ", SoA scalar " << scalarPerSecond << " (" << scalarPerSecond / objectsPerSecond << "x), SoA SIMD " << simdPerSecond
+        << " (" << simdPerSecond / objectsPerSecond << "x)" << (objectHits + scalarHits + simdHits == 0 ? " (no hits?)" : "") << std::endl;
+}
+
+static void benchmarkLevelState(unsigned int tilesX, unsigned int tilesY)
+{
+    std::vector<std::vector<unsigned int>> tiles;
+    generateTiles(tilesX, tilesY, tiles);
+    GameLevel level;
+    level.LoadTiles(tiles, tilesX * 40, tilesY * 20);
+
+    // the live count and the journal must agree with a full scan while the level is played down and reset
+    unsigned int bricks = countBricks(level), destructible = level.RemainingBricks(), errors = 0;
+    for (unsigned int slot = 0; slot < level.SlotCount(); ++slot)
+        level.DestroyBrick(slot);
+    if (!level.IsCompleted() || level.Changes().size() != bricks || countBricks(level) != 0)
+        ++errors;
+    level.ClearChanges();
+    level.Reset();
+    if (level.Changes().size() != bricks || level.RemainingBricks() != destructible || countBricks(level) != bricks)
+        ++errors;
+    level.ClearChanges();
+
+    // completion check: scanning every slot (before) vs reading the live count, measured with only the
+    // solid bricks left, which is where the scan has to look at every slot and the game spends most frames
+    for (unsigned int slot = 0; slot < level.SlotCount(); ++slot)
+        if (!level.IsSolid(slot))
+            level.DestroyBrick(slot);
+    unsigned int completed = 0;
+    double scan = measure([&](unsigned long long) {
+        bool done = true;
+        for (unsigned int slot = 0; slot < level.SlotCount() && done; ++slot)
+            if (level.BrickType[slot] > 1 && !level.IsDestroyed(slot))
+                done = false;
+        completed += done;
+    });
+    double counted = measure([&](unsigned long long) {
+        completed += level.IsCompleted();
+    });
+    level.Reset();
+    level.ClearChanges();
+
+    // reset: rebuilding from tile data (what reloading did, minus reading the file) vs the bulk mask restore
+    double reload = measure([&](unsigned long long) {
+        level.LoadTiles(tiles, tilesX * 40, tilesY * 20);
+    });
+    double restore = measure([&](unsigned long long i) {
+        level.DestroyBrick(static_cast<unsigned int>(i % level.SlotCount()));
+        level.Reset();
+        level.ClearChanges();
+    });
+
+    std::cout << "level state " << tilesX << "x" << tilesY << " (" << countBricks(level) << " bricks): completion checks/s: scan "
+        << scan << ", live count " << counted << "; resets/s: reload " << reload << ", bulk restore " << restore
+        << " (" << restore / reload << "x); journal errors " << errors << (completed == 0 ? " (no checks?)" : "") << std::endl;
+}
+
+static void benchmarkBalls(unsigned int ballCount)
+{
+    // a headless game on a generated level, so the run doesn't depend on the level files
+    Game game(800, 600);
+    game.Headless = true;
+    game.Init();
+    std::vector<std::vector<unsigned int>> tiles;
+    generateTiles(15, 8, tiles);
+    game.Level = 0;
+    game.Levels[0].LoadTiles(tiles, game.Width, game.Height / 2);
+    // outside GAME_ACTIVE the balls still move but clearing the level doesn't end the run
+    game.State = GAME_MENU;
+
+    // keeps ballCount balls in play: balls lost at the bottom are replaced below the bricks
+    uint32_t seed = 777;
+    auto topUp = [&]() {
+        while (game.Balls.size() < ballCount)
+        {
+            float angle = 3.6f + nextRandom(seed) * 2.2f; // upwards, within ~60 degrees of vertical
+            glm::vec2 position(nextRandom(seed) * (game.Width - 25.0f), game.Height / 2 + nextRandom(seed) * game.Height / 3);
+            game.SpawnBall(position, glm::vec2(std::cos(angle), std::sin(angle)) * 364.0f);
+        }
+    };
+    const float dt = 1.0f / 120.0f;
+    unsigned long long ballSteps = 0;
+    auto tick = [&](unsigned long long) {
+        topUp();
+        if (game.Levels[0].IsCompleted())
+            game.Levels[0].Reset();
+        ballSteps += game.Balls.size();
+        game.Step(dt);
+        game.EndFrame();
+    };
+    for (unsigned int i = 0; i < 120; ++i)
+        tick(i);
+    ballSteps = 0;
+    double ticksPerSecond = measure(tick, 2.0);
+    double averageBalls = ballSteps / (ticksPerSecond * 2.0);
+
+    // two 120 Hz ticks have to fit in every 60 fps frame
+    double frameMs = 2000.0 / ticksPerSecond;
+    std::cout << "balls " << ballCount << ": " << ticksPerSecond << " ticks/s, " << 1000.0 / ticksPerSecond << " ms per tick, "
+        << frameMs << " ms of simulation per 60 fps frame (" << (frameMs < 1000.0 / 60.0 ? "fits" : "over") << " the 16.7 ms budget), "
+        << std::min(averageBalls, static_cast<double>(ballCount)) << " balls in play on average" << std::endl;
+}
+
+static void benchmarkRandom()
+{
+    // the draws the game makes: a d100 for particles and a 1-in-n power-up roll
+    const unsigned int draws = 1024;
+    unsigned int sum = 0;
+    double crt = measure([&](unsigned long long) {
+        for (unsigned int i = 0; i < draws; ++i)
+            sum += rand() % 100;
+    }) * draws;
+    Random random(1, "bench");
+    double pcg = measure([&](unsigned long long) {
+        for (unsigned int i = 0; i < draws; ++i)
+            sum += random.Below(100);
+    }) * draws;
+    std::cout << "random: rand() % 100 " << crt << " draws/s, Random::Below(100) " << pcg << " draws/s ("
+        << pcg / crt << "x)" << (sum == 0 ? " (no draws?)" : "") << std::endl;
+}
+
+// opens a hidden window with a GL 3.3 core context for the rendering benchmarks
+static GLFWwindow* createContext(unsigned int width, unsigned int height)
+{
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(width, height, "Breakout benchmark", nullptr, nullptr);
+    if (!window)
+    {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        return nullptr;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return nullptr;
+    }
+    std::cout << "renderer: " << glGetString(GL_RENDERER) << std::endl;
+    glViewport(0, 0, width, height);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    return window;
+}
+
+static void benchmarkSprites(unsigned int tilesX, unsigned int tilesY)
+{
+    // a level squeezed into the window, so the cost is in submitting sprites rather than filling pixels
+    const unsigned int width = 800, height = 600;
+    std::vector<std::vector<unsigned int>> tiles;
+    generateTiles(tilesX, tilesY, tiles);
+    GameLevel level;
+    level.LoadTiles(tiles, width, height);
+    FrameUniforms frameUniforms;
+    frameUniforms.Data.Projection = glm::ortho(0.0f, static_cast<float>(width), static_cast<float>(height), 0.0f, -1.0f, 1.0f);
+    frameUniforms.Upload();
+    Shader shader = ResourceManager::GetShader("sprite");
+    SpriteRenderer renderer(shader);
+
+    SpriteBuffer sprites;
+    level.Build(sprites);
+    renderer.Upload(sprites);
+    uint32_t seed = 1;
+
+    // one frame: draw the level, then wait for the GPU so the whole cost is counted
+    enum { PER_SPRITE, BATCHED, STATIC_BUFFER };
+    const char* modeNames[] = { "one draw per sprite", "batched", "static buffer" };
+    double submitSeconds = 0.0;
+    unsigned long long frames = 0;
+    auto frame = [&](int mode) {
+        ++frames;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        glClear(GL_COLOR_BUFFER_BIT);
+        if (mode == STATIC_BUFFER)
+        {
+            // the bricks are already on the GPU: knock one out like a hit would and patch just that one
+            if (level.IsCompleted())
+                level.Reset();
+            level.DestroyBrick(static_cast<unsigned int>(nextRandom(seed) * level.SlotCount()));
+            level.Sync(sprites);
+            level.ClearChanges();
+            renderer.Draw(sprites);
+        }
+        else
+        {
+            if (mode == BATCHED)
+                renderer.Begin();
+            level.Draw(renderer); // outside Begin/Flush every sprite is its own draw
+            if (mode == BATCHED)
+                renderer.Flush();
+        }
+        submitSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        glFinish();
+    };
+    for (int mode = PER_SPRITE; mode <= STATIC_BUFFER; ++mode)
+    {
+        frame(mode); // warm up
+        renderer.ResetStats();
+        submitSeconds = 0.0;
+        frames = 0;
+        double framesPerSecond = measure([&](unsigned long long) { frame(mode); }, 2.0);
+        std::cout << "sprites " << tilesX << "x" << tilesY << " (" << countBricks(level) << " bricks) "
+            << modeNames[mode] << ": " << static_cast<double>(renderer.DrawCalls) / frames << " draw calls, "
+            << submitSeconds * 1000.0 / frames << " ms CPU submit, " << 1000.0 / framesPerSecond << " ms per frame" << std::endl;
+    }
+}
+
+static void benchmarkText()
+{
+    // the menu screen's strings
+    const unsigned int width = 800, height = 600;
+    FrameUniforms frameUniforms;
+    frameUniforms.Data.Projection = glm::ortho(0.0f, static_cast<float>(width), static_cast<float>(height), 0.0f, -1.0f, 1.0f);
+    frameUniforms.Upload();
+    TextRenderer text;
+    text.Load("fonts/OCRAEXT.TTF", 24);
+    TextObject retained[3];
+    retained[0].SetText("Lives:3");
+    retained[0].SetPosition(5.0f, 5.0f);
+    retained[1].SetText("Press ENTER to start");
+    retained[1].SetPosition(250.0f, height / 2.0f);
+    retained[2].SetText("Press W or S to select level");
+    retained[2].SetPosition(245.0f, height / 2.0f + 20.0f, 0.75f);
+    double submitSeconds = 0.0;
+    unsigned long long frames = 0;
+    auto frame = [&](bool retain) {
+        ++frames;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        glClear(GL_COLOR_BUFFER_BIT);
+        if (retain)
+        {
+            for (TextObject& string : retained)
+                text.Draw(string);
+        }
+        else
+        {
+            text.RenderText("Lives:3", 5.0f, 5.0f, 1.0f);
+            text.RenderText("Press ENTER to start", 250.0f, height / 2.0f, 1.0f);
+            text.RenderText("Press W or S to select level", 245.0f, height / 2.0f + 20.0f, 0.75f);
+        }
+        submitSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        glFinish();
+    };
+    for (int retain = 0; retain < 2; ++retain)
+    {
+        frame(retain != 0); // warm up
+        text.DrawCalls = 0;
+        text.Layouts = 0;
+        submitSeconds = 0.0;
+        frames = 0;
+        double framesPerSecond = measure([&](unsigned long long) { frame(retain != 0); }, 2.0);
+        std::cout << "text (menu screen, " << text.Atlas.Width << "x" << text.Atlas.Height << " glyph atlas) "
+            << (retain ? "retained" : "immediate") << ": " << static_cast<double>(text.DrawCalls) / frames << " draw calls, "
+            << static_cast<double>(text.Layouts) / frames << " layouts, " << submitSeconds * 1000.0 / frames << " ms CPU submit, "
+            << 1000.0 / framesPerSecond << " ms per frame" << std::endl;
+    }
+}
+
+static void benchmarkTextures(bool compress)
+{
+    // the game's textures: decoding the source images against reading their cooked versions
+    const char* files[] = { "textures/background.jpg", "textures/particle.png", "textures/awesomeface.png", "textures/block.png",
+        "textures/block_solid.png", "textures/paddle.png", "textures/powerup_speed.png", "textures/powerup_sticky.png",
+        "textures/powerup_increase.png", "textures/powerup_confuse.png", "textures/powerup_chaos.png", "textures/powerup_passthrough.png" };
+    std::vector<std::vector<char>> sources, cooked;
+    size_t sourceBytes = 0, cookedBytes = 0;
+    for (const char* file : files)
+    {
+        std::vector<char> source, texture;
+        FileView view;
+        if (!FileSystem::ReadFile(file, source))
+            return;
+        view.Data = source.data();
+        view.Size = source.size();
+        if (!CookTexture(view, compress, texture))
+            return;
+        sourceBytes += source.size();
+        cookedBytes += texture.size();
+        sources.push_back(source);
+        cooked.push_back(texture);
+    }
+    unsigned int count = static_cast<unsigned int>(sources.size());
+    double decoded = measure([&](unsigned long long i) {
+        const std::vector<char>& source = sources[i % count];
+        int width, height, channels;
+        stbi_image_free(stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(source.data()), static_cast<int>(source.size()), &width, &height, &channels, 0));
+    });
+    std::vector<unsigned char> pixels;
+    double read = measure([&](unsigned long long i) {
+        FileView view;
+        view.Data = cooked[i % count].data();
+        view.Size = cooked[i % count].size();
+        CookedTexture texture;
+        if (ParseCookedTexture(view, texture))
+            pixels.assign(texture.Data, texture.Data + texture.Size);
+    });
+    std::cout << "textures" << (compress ? " (bc1)" : "") << ": " << count << " images, " << sourceBytes / 1024 << " KiB encoded, "
+        << cookedBytes / 1024 << " KiB cooked; decode " << count * 1000.0 / decoded << " ms, cooked "
+        << count * 1000.0 / read << " ms per set" << std::endl;
+}
+
+static void benchmarkUniforms()
+{
+    // a per-draw uniform update (the text color), three ways
+    Shader shader = ResourceManager::GetShader("text");
+    shader.Use();
+    Uniform<glm::vec3> color = shader.GetUniform<glm::vec3>("textColor");
+    glm::vec3 value(1.0f, 0.5f, 0.25f);
+    double queried = measure([&](unsigned long long i) {
+        glUniform3f(glGetUniformLocation(shader.ID, "textColor"), value.x + i, value.y, value.z);
+    });
+    double byName = measure([&](unsigned long long i) {
+        shader.SetVector3f("textColor", value.x + i, value.y, value.z);
+    });
+    double handle = measure([&](unsigned long long i) {
+        color.Set(glm::vec3(value.x + i, value.y, value.z));
+    });
+    glFinish();
+    std::cout << "uniforms: glGetUniformLocation " << queried << " sets/s, by name " << byName
+        << " sets/s, handle " << handle << " sets/s" << std::endl;
+}
+
+static void benchmarkParticles(unsigned int count)
+{
+    const unsigned int width = 800, height = 600;
+    FrameUniforms frameUniforms;
+    frameUniforms.Data.Projection = glm::ortho(0.0f, static_cast<float>(width), static_cast<float>(height), 0.0f, -1.0f, 1.0f);
+    frameUniforms.Upload();
+    ParticleGenerator particles(ResourceManager::GetShader("particle"), ResourceManager::GetTexture("particle"), count);
+    particles.Seed(1);
+    // spread the particles over the screen, like a lot of balls would
+    GameObject emitter;
+    uint32_t seed = 1;
+    for (unsigned int i = 0; i < count; i += 10)
+    {
+        emitter.Position = glm::vec2(nextRandom(seed) * width, nextRandom(seed) * height);
+        particles.Emit(emitter, 10);
+    }
+
+    // one frame: a (tiny) update so nothing dies, then the draw, waiting for the GPU so the whole cost is counted
+    double drawSeconds = 0.0;
+    unsigned long long frames = 0;
+    double framesPerSecond = measure([&](unsigned long long) {
+        particles.Update(0.00001f);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        glClear(GL_COLOR_BUFFER_BIT);
+        particles.Draw();
+        drawSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        glFinish();
+        ++frames;
+    }, 2.0);
+    std::cout << "particles " << count << ": " << static_cast<double>(particles.DrawCalls) / frames << " draw calls, "
+        << drawSeconds * 1000.0 / frames << " ms CPU draw, " << 1000.0 / framesPerSecond << " ms per frame" << std::endl;
+}
+
+// live particles of a snapshot in a canonical order, so the two simulations can be compared regardless of slot assignment
+static std::vector<Particle> liveParticles(std::vector<Particle> particles)
+{
+    particles.erase(std::remove_if(particles.begin(), particles.end(), [](const Particle& p) { return p.Life <= 0.0f; }), particles.end());
+    auto key = [](const Particle& p) {
+        return std::make_tuple(std::lround(p.Life * 1000.0f), std::lround(p.Position.x * 100.0f), std::lround(p.Position.y * 100.0f), std::lround(p.Color.r * 100.0f));
+    };
+    std::sort(particles.begin(), particles.end(), [&key](const Particle& a, const Particle& b) { return key(a) < key(b); });
+    return particles;
+}
+
+static bool benchmarkGpuParticles(unsigned int count, unsigned int steps)
+{
+    Shader update = ResourceManager::GetShader("particle_update");
+    ParticleGenerator cpu(ResourceManager::GetShader("particle"), ResourceManager::GetTexture("particle"), count);
+    ParticleGenerator gpu(ResourceManager::GetShader("particle"), ResourceManager::GetTexture("particle"), count, update);
+    cpu.Seed(1);
+    gpu.Seed(1);
+    // emit enough per step to keep about all slots busy (particles live one second), from a moving emitter
+    const float dt = 1.0f / 60.0f;
+    unsigned int perStep = std::max(1u, count / 62);
+    GameObject emitter;
+    emitter.Velocity = glm::vec2(120.0f, -80.0f);
+    double cpuSeconds = 0.0, gpuSeconds = 0.0;
+    for (unsigned int step = 0; step < steps; ++step)
+    {
+        emitter.Position = glm::vec2(400.0f + 300.0f * std::sin(step * 0.05f), 300.0f + 200.0f * std::cos(step * 0.07f));
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        cpu.Emit(emitter, perStep);
+        cpu.Update(dt);
+        std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+        gpu.Emit(emitter, perStep);
+        gpu.Update(dt);
+        glFinish();
+        cpuSeconds += std::chrono::duration<double>(middle - start).count();
+        gpuSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - middle).count();
+    }
+
+    // both paths have to agree on every live particle
+    std::vector<Particle> expected = liveParticles(cpu.Snapshot()), actual = liveParticles(gpu.Snapshot());
+    float maxError = 0.0f;
+    bool match = expected.size() == actual.size();
+    for (size_t i = 0; match && i < expected.size(); ++i)
+    {
+        const Particle& a = expected[i];
+        const Particle& b = actual[i];
+        maxError = std::max({ maxError, glm::length(a.Position - b.Position), glm::length(a.Velocity - b.Velocity),
+            glm::length(a.Color - b.Color), std::fabs(a.Life - b.Life) });
+    }
+    match = match && maxError < 1e-3f;
+    std::cout << "gpu particles " << count << " x " << steps << " steps: " << expected.size() << " live on the CPU, " << actual.size()
+        << " on the GPU, max difference " << maxError << (match ? " (match)" : " (MISMATCH)") << "; update "
+        << cpuSeconds * 1000.0 / steps << " ms CPU, " << gpuSeconds * 1000.0 / steps << " ms GPU per step" << std::endl;
+    return match;
+}
+
+bool RunBenchmark(const std::string& name, bool& passed)
+{
+    passed = true;
+    if (name == "broadphase")
+    {
+        benchmarkBroadphase(200, 200);
+        benchmarkBroadphase(1000, 1000);
+        return true;
+    }
+    if (name == "bricks")
+    {
+        benchmarkBricks(15, 8);
+        benchmarkBricks(200, 200);
+        return true;
+    }
+    if (name == "balls")
+    {
+        benchmarkBalls(1);
+        benchmarkBalls(1000);
+        benchmarkBalls(10000);
+        return true;
+    }
+    if (name == "sprites")
+    {
+        if (!createContext(800, 600))
+            return true;
+        ResourceManager::LoadShader("shaders/sprite.vs", "shaders/sprite.frag", nullptr, "sprite");
+        ResourceManager::LoadTexture("textures/block.png", false, "block");
+        ResourceManager::LoadTexture("textures/block_solid.png", false, "block_solid");
+        benchmarkSprites(15, 8);
+        benchmarkSprites(200, 150);
+        ResourceManager::Clear();
+        glfwTerminate();
+        return true;
+    }
+    if (name == "particles")
+    {
+        if (!createContext(800, 600))
+            return true;
+        ResourceManager::LoadShader("shaders/particle.vs", "shaders/particle.frag", nullptr, "particle");
+        ResourceManager::LoadTexture("textures/particle.png", true, "particle");
+        benchmarkParticles(500);
+        benchmarkParticles(100000);
+        ResourceManager::Clear();
+        glfwTerminate();
+        return true;
+    }
+    if (name == "gpuparticles")
+    {
+        if (!createContext(800, 600))
+            return true;
+        ResourceManager::LoadShader("shaders/particle.vs", "shaders/particle.frag", nullptr, "particle");
+        ResourceManager::LoadFeedbackShader("shaders/particle_update.vs",
+            { "outPosition", "outVelocity", "outColor", "outLife" }, "particle_update");
+        ResourceManager::LoadTexture("textures/particle.png", true, "particle");
+        passed = benchmarkGpuParticles(500, 600);
+        passed = benchmarkGpuParticles(100000, 120) && passed;
+        ResourceManager::Clear();
+        glfwTerminate();
+        return true;
+    }
+    if (name == "text")
+    {
+        if (!createContext(800, 600))
+            return true;
+        benchmarkText();
+        ResourceManager::Clear();
+        glfwTerminate();
+        return true;
+    }
+    if (name == "uniforms")
+    {
+        if (!createContext(800, 600))
+            return true;
+        ResourceManager::LoadShader("shaders/text_2d.vs", "shaders/text_2d.fs", nullptr, "text");
+        benchmarkUniforms();
+        ResourceManager::Clear();
+        glfwTerminate();
+        return true;
+    }
+    if (name == "textures")
+    {
+        benchmarkTextures(false);
+        benchmarkTextures(true);
+        return true;
+    }
+    if (name == "random")
+    {
+        benchmarkRandom();
+        return true;
+    }
+    if (name == "level")
+    {
+        benchmarkLevelState(15, 8);
+        benchmarkLevelState(200, 200);
+        return true;
+    }
+    return false;
+}
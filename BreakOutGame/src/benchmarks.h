@@ -0,0 +1,22 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <string>
+
+
+// Runs the benchmark with the given name (see --bench in program.cpp) and
+// prints its results to stdout. Benchmarks run without a GL context,
+// except for the rendering ones, which open a hidden window.
+// Returns false if there is no benchmark with that name; passed is set to
+// false when a benchmark that checks its results finds them wrong.
+bool RunBenchmark(const std::string& name, bool& passed);
+
+#endif
@@ -0,0 +1,175 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include "collision.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define COLLISION_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define COLLISION_SSE2
+#endif
+
+
+bool SweepCircleAABB(glm::vec2 center, float radius, glm::vec2 delta, glm::vec2 boxMin, glm::vec2 boxMax, SweepHit& hit)
+{
+    // already touching? then the contact is immediate (unless we're separating)
+    glm::vec2 closest = glm::clamp(center, boxMin, boxMax);
+    glm::vec2 difference = center - closest;
+    float distance2 = glm::dot(difference, difference);
+    if (distance2 <= radius * radius)
+    {
+        glm::vec2 normal;
+        if (distance2 > 0.0f)
+            normal = difference / std::sqrt(distance2);
+        else
+        {   // center inside the box: push out along the axis of least penetration
+            glm::vec2 toMin = center - boxMin;
+            glm::vec2 toMax = boxMax - center;
+            if (std::min(toMin.x, toMax.x) < std::min(toMin.y, toMax.y))
+                normal = glm::vec2(toMin.x < toMax.x ? -1.0f : 1.0f, 0.0f);
+            else
+                normal = glm::vec2(0.0f, toMin.y < toMax.y ? -1.0f : 1.0f);
+        }
+        if (glm::dot(delta, normal) >= 0.0f)
+            return false;
+        hit.Time = 0.0f;
+        hit.Normal = normal;
+        return true;
+    }
+    // the circle's center hits the box grown by radius on every side (with rounded corners);
+    // first intersect the center's path with the grown box using the slab method
+    glm::vec2 grownMin = boxMin - radius;
+    glm::vec2 grownMax = boxMax + radius;
+    float tEnter = 0.0f, tExit = 1.0f;
+    int enterAxis = -1;
+    for (int axis = 0; axis < 2; ++axis)
+    {
+        if (std::abs(delta[axis]) < 1e-8f)
+        {   // not moving along this axis: must already be within the slab
+            if (center[axis] < grownMin[axis] || center[axis] > grownMax[axis])
+                return false;
+            continue;
+        }
+        float t0 = (grownMin[axis] - center[axis]) / delta[axis];
+        float t1 = (grownMax[axis] - center[axis]) / delta[axis];
+        if (t0 > t1)
+            std::swap(t0, t1);
+        if (t0 > tEnter)
+        {
+            tEnter = t0;
+            enterAxis = axis;
+        }
+        tExit = std::min(tExit, t1);
+        if (tEnter > tExit)
+            return false;
+    }
+    // if the entry point lies beyond a corner of the original box, the real surface
+    // there is the rounded corner: intersect with a circle of radius around that corner
+    glm::vec2 point = center + delta * tEnter;
+    bool outsideX = point.x < boxMin.x || point.x > boxMax.x;
+    bool outsideY = point.y < boxMin.y || point.y > boxMax.y;
+    if (outsideX && outsideY)
+    {
+        glm::vec2 corner(point.x < boxMin.x ? boxMin.x : boxMax.x, point.y < boxMin.y ? boxMin.y : boxMax.y);
+        glm::vec2 m = center - corner;
+        float a = glm::dot(delta, delta);
+        float b = glm::dot(m, delta);
+        float c = glm::dot(m, m) - radius * radius;
+        float discriminant = b * b - a * c;
+        if (a <= 0.0f || discriminant < 0.0f)
+            return false;
+        float t = (-b - std::sqrt(discriminant)) / a;
+        if (t < 0.0f || t > 1.0f)
+            return false;
+        hit.Time = t;
+        hit.Normal = glm::normalize(center + delta * t - corner);
+        return true;
+    }
+    if (enterAxis < 0) // started inside the grown box without touching: only possible in a corner region
+        return false;
+    hit.Time = tEnter;
+    hit.Normal = glm::vec2(0.0f);
+    hit.Normal[enterAxis] = delta[enterAxis] > 0.0f ? -1.0f : 1.0f;
+    return true;
+}
+
+
+// returns the n (<= 8) destroyed bits starting at index
+static inline uint32_t destroyedBits(const uint32_t* mask, unsigned int index, unsigned int n)
+{
+    unsigned int word = index >> 5, shift = index & 31;
+    uint32_t bits = mask[word] >> shift;
+    if (shift + n > 32)
+        bits |= mask[word + 1] << (32 - shift);
+    return bits & ((1u << n) - 1);
+}
+
+unsigned int OverlapCircleBricksScalar(const float* brickX, const float* brickY, const uint32_t* destroyedMask,
+    unsigned int first, unsigned int count, glm::vec2 brickSize, glm::vec2 center, float radius, unsigned int* hits)
+{
+    unsigned int found = 0;
+    float radius2 = radius * radius;
+    for (unsigned int i = first; i < first + count; ++i)
+    {
+        if ((destroyedMask[i >> 5] >> (i & 31)) & 1u)
+            continue;
+        // distance from the circle's center to the closest point of the brick
+        float dx = std::min(std::max(center.x, brickX[i]), brickX[i] + brickSize.x) - center.x;
+        float dy = std::min(std::max(center.y, brickY[i]), brickY[i] + brickSize.y) - center.y;
+        if (dx * dx + dy * dy <= radius2)
+            hits[found++] = i;
+    }
+    return found;
+}
+
+unsigned int OverlapCircleBricks(const float* brickX, const float* brickY, const uint32_t* destroyedMask,
+    unsigned int first, unsigned int count, glm::vec2 brickSize, glm::vec2 center, float radius, unsigned int* hits)
+{
+    unsigned int found = 0;
+    unsigned int i = first, end = first + count;
+#if defined(COLLISION_AVX2)
+    const __m256 cx = _mm256_set1_ps(center.x), cy = _mm256_set1_ps(center.y);
+    const __m256 sx = _mm256_set1_ps(brickSize.x), sy = _mm256_set1_ps(brickSize.y);
+    const __m256 r2 = _mm256_set1_ps(radius * radius);
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256 minX = _mm256_loadu_ps(brickX + i);
+        __m256 minY = _mm256_loadu_ps(brickY + i);
+        __m256 dx = _mm256_sub_ps(_mm256_min_ps(_mm256_max_ps(cx, minX), _mm256_add_ps(minX, sx)), cx);
+        __m256 dy = _mm256_sub_ps(_mm256_min_ps(_mm256_max_ps(cy, minY), _mm256_add_ps(minY, sy)), cy);
+        __m256 d2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+        uint32_t lanes = _mm256_movemask_ps(_mm256_cmp_ps(d2, r2, _CMP_LE_OQ)) & ~destroyedBits(destroyedMask, i, 8);
+        for (unsigned int lane = 0; lanes; ++lane, lanes >>= 1)
+            if (lanes & 1u)
+                hits[found++] = i + lane;
+    }
+#elif defined(COLLISION_SSE2)
+    const __m128 cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y);
+    const __m128 sx = _mm_set1_ps(brickSize.x), sy = _mm_set1_ps(brickSize.y);
+    const __m128 r2 = _mm_set1_ps(radius * radius);
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 minX = _mm_loadu_ps(brickX + i);
+        __m128 minY = _mm_loadu_ps(brickY + i);
+        __m128 dx = _mm_sub_ps(_mm_min_ps(_mm_max_ps(cx, minX), _mm_add_ps(minX, sx)), cx);
+        __m128 dy = _mm_sub_ps(_mm_min_ps(_mm_max_ps(cy, minY), _mm_add_ps(minY, sy)), cy);
+        __m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        uint32_t lanes = _mm_movemask_ps(_mm_cmple_ps(d2, r2)) & ~destroyedBits(destroyedMask, i, 4);
+        for (unsigned int lane = 0; lanes; ++lane, lanes >>= 1)
+            if (lanes & 1u)
+                hits[found++] = i + lane;
+    }
+#endif
+    // remaining bricks (or all of them without SIMD support)
+    return found + OverlapCircleBricksScalar(brickX, brickY, destroyedMask, i, end - i, brickSize, center, radius, hits + found);
+}
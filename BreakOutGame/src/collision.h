@@ -0,0 +1,38 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+
+// Describes the first contact found by a swept collision query
+struct SweepHit {
+    float     Time;   // fraction [0,1] of the movement at which the shapes first touch
+    glm::vec2 Normal; // contact normal, pointing from the box towards the circle
+};
+
+// Sweeps a circle (center, radius) moving by delta against the box [boxMin, boxMax].
+// Returns true and fills hit with the earliest contact if they touch during the movement.
+// A circle that already touches the box reports a hit at Time 0, unless it is moving away.
+bool SweepCircleAABB(glm::vec2 center, float radius, glm::vec2 delta, glm::vec2 boxMin, glm::vec2 boxMax, SweepHit& hit);
+
+// Tests a circle against count equally sized bricks stored as structure-of-arrays (top-left
+// corners in brickX/brickY, one destroyed bit per brick), starting at index first. Writes the
+// index of every live brick the circle overlaps to hits and returns how many were written.
+// Uses AVX2 (8 bricks at a time) or SSE2 (4 at a time) when compiled for it.
+unsigned int OverlapCircleBricks(const float* brickX, const float* brickY, const uint32_t* destroyedMask,
+    unsigned int first, unsigned int count, glm::vec2 brickSize, glm::vec2 center, float radius, unsigned int* hits);
+// Same as OverlapCircleBricks, one brick at a time
+unsigned int OverlapCircleBricksScalar(const float* brickX, const float* brickY, const uint32_t* destroyedMask,
+    unsigned int first, unsigned int count, glm::vec2 brickSize, glm::vec2 center, float radius, unsigned int* hits);
+
+#endif
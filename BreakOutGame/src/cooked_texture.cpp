@@ -0,0 +1,305 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include "cooked_texture.h"
+#include "asset_pack.h"
+#include "texture.h"
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static const char COOKED_TEXTURE_MAGIC[4] = { 'B', 'T', 'E', 'X' };
+
+static_assert(sizeof(CookedTextureHeader) == 32, "cooked texture header layout");
+
+
+std::string CookedTexturePath(const std::string& source)
+{
+    size_t dot = source.find_last_of('.');
+    if (dot == std::string::npos || source.find('/', dot) != std::string::npos)
+        return source + ".tex";
+    return source.substr(0, dot) + ".tex";
+}
+
+// the bytes of one level, computed wide enough that no header can overflow it
+static uint64_t levelSize(uint32_t format, uint32_t width, uint32_t height)
+{
+    if (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+        return (width + 3ull) / 4 * ((height + 3ull) / 4) * 8;
+    return static_cast<uint64_t>(width) * height * (format == GL_RGBA ? 4 : 3);
+}
+
+uint32_t CookedSourceHash(const FileView& source)
+{
+    uint32_t hash = 2166136261u;
+    for (char c : source)
+        hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+    return hash;
+}
+
+bool ParseCookedTexture(const FileView& file, CookedTexture& texture)
+{
+    if (file.Size < sizeof(CookedTextureHeader))
+        return false;
+    const CookedTextureHeader* header = reinterpret_cast<const CookedTextureHeader*>(file.Data);
+    if (std::memcmp(header->Magic, COOKED_TEXTURE_MAGIC, 4) != 0 || header->Version != COOKED_TEXTURE_VERSION
+        || header->Width == 0 || header->Height == 0 || header->Levels == 0 || header->Levels > 32
+        || header->Width > MAX_COOKED_TEXTURE_SIZE || header->Height > MAX_COOKED_TEXTURE_SIZE)
+        return false;
+    if (header->Format != GL_RGB && header->Format != GL_RGBA && header->Format != GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+        return false;
+    // every level has to be there
+    uint64_t size = 0;
+    for (uint32_t level = 0; level < header->Levels; ++level)
+        size += levelSize(header->Format, std::max(header->Width >> level, 1u), std::max(header->Height >> level, 1u));
+    if (size > file.Size - sizeof(CookedTextureHeader))
+        return false;
+    texture.Width = header->Width;
+    texture.Height = header->Height;
+    texture.Format = header->Format;
+    texture.Levels = header->Levels;
+    texture.SourceSize = header->SourceSize;
+    texture.SourceHash = header->SourceHash;
+    texture.Data = reinterpret_cast<const unsigned char*>(file.Data) + sizeof(CookedTextureHeader);
+    texture.Size = static_cast<size_t>(size);
+    return true;
+}
+
+// BC1 colors are 5:6:5; these expand them back to 8 bits the way the hardware does
+static void unpack565(uint16_t color, int rgb[3])
+{
+    rgb[0] = ((color >> 11) & 31) * 255 / 31;
+    rgb[1] = ((color >> 5) & 63) * 255 / 63;
+    rgb[2] = (color & 31) * 255 / 31;
+}
+
+static uint16_t pack565(const float rgb[3])
+{
+    int r = static_cast<int>(std::min(std::max(rgb[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+    int g = static_cast<int>(std::min(std::max(rgb[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+    int b = static_cast<int>(std::min(std::max(rgb[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+    return static_cast<uint16_t>(r << 11 | g << 5 | b);
+}
+
+// the four colors of a block: both endpoints and two in between (or one in between and black)
+static void blockPalette(uint16_t color0, uint16_t color1, int palette[4][3])
+{
+    unpack565(color0, palette[0]);
+    unpack565(color1, palette[1]);
+    for (int c = 0; c < 3; ++c)
+    {
+        if (color0 > color1)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        else
+        {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+}
+
+// encodes a 4x4 block of RGB texels; the endpoints are the extremes along the block's principal axis
+static void compressBlock(const unsigned char texels[16][3], unsigned char* block)
+{
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; ++i)
+        for (int c = 0; c < 3; ++c)
+            mean[c] += texels[i][c] / 16.0f;
+    float covariance[6] = { 0.0f }; // rr, rg, rb, gg, gb, bb
+    for (int i = 0; i < 16; ++i)
+    {
+        float d[3] = { texels[i][0] - mean[0], texels[i][1] - mean[1], texels[i][2] - mean[2] };
+        covariance[0] += d[0] * d[0]; covariance[1] += d[0] * d[1]; covariance[2] += d[0] * d[2];
+        covariance[3] += d[1] * d[1]; covariance[4] += d[1] * d[2]; covariance[5] += d[2] * d[2];
+    }
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (int iteration = 0; iteration < 8; ++iteration)
+    {
+        float next[3] = {
+            covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+            covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+            covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2] };
+        float length = std::max(std::max(std::fabs(next[0]), std::fabs(next[1])), std::fabs(next[2]));
+        if (length == 0.0f)
+            break; // a flat block; any axis will do
+        for (int c = 0; c < 3; ++c)
+            axis[c] = next[c] / length;
+    }
+    float lowest = 0.0f, highest = 0.0f;
+    for (int i = 0; i < 16; ++i)
+    {
+        float t = (texels[i][0] - mean[0]) * axis[0] + (texels[i][1] - mean[1]) * axis[1] + (texels[i][2] - mean[2]) * axis[2];
+        lowest = std::min(lowest, t);
+        highest = std::max(highest, t);
+    }
+    float axisLength = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    float low[3], high[3];
+    for (int c = 0; c < 3; ++c)
+    {
+        low[c] = mean[c] + axis[c] * lowest / axisLength;
+        high[c] = mean[c] + axis[c] * highest / axisLength;
+    }
+    uint16_t color0 = pack565(high), color1 = pack565(low);
+    if (color0 < color1)
+        std::swap(color0, color1);
+    uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        int palette[4][3];
+        blockPalette(color0, color1, palette);
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0, bestDistance = 0;
+            for (int p = 0; p < 4; ++p)
+            {
+                int distance = 0;
+                for (int c = 0; c < 3; ++c)
+                    distance += (texels[i][c] - palette[p][c]) * (texels[i][c] - palette[p][c]);
+                if (p == 0 || distance < bestDistance)
+                {
+                    best = p;
+                    bestDistance = distance;
+                }
+            }
+            indices |= static_cast<uint32_t>(best) << (2 * i);
+        }
+    }
+    block[0] = color0 & 0xFF; block[1] = color0 >> 8;
+    block[2] = color1 & 0xFF; block[3] = color1 >> 8;
+    for (int i = 0; i < 4; ++i)
+        block[4 + i] = (indices >> (8 * i)) & 0xFF;
+}
+
+static void compressBC1(const unsigned char* pixels, int channels, unsigned int width, unsigned int height, unsigned char* blocks)
+{
+    for (unsigned int by = 0; by < height; by += 4)
+    {
+        for (unsigned int bx = 0; bx < width; bx += 4)
+        {
+            // blocks hanging over the edge repeat the last row and column
+            unsigned char texels[16][3];
+            for (unsigned int i = 0; i < 16; ++i)
+            {
+                unsigned int x = std::min(bx + i % 4, width - 1), y = std::min(by + i / 4, height - 1);
+                std::copy(pixels + (y * width + x) * channels, pixels + (y * width + x) * channels + 3, texels[i]);
+            }
+            compressBlock(texels, blocks);
+            blocks += 8;
+        }
+    }
+}
+
+void DecompressBC1(const unsigned char* blocks, unsigned int width, unsigned int height, unsigned char* rgb)
+{
+    for (unsigned int by = 0; by < height; by += 4)
+    {
+        for (unsigned int bx = 0; bx < width; bx += 4)
+        {
+            int palette[4][3];
+            blockPalette(static_cast<uint16_t>(blocks[0] | blocks[1] << 8), static_cast<uint16_t>(blocks[2] | blocks[3] << 8), palette);
+            uint32_t indices = blocks[4] | blocks[5] << 8 | blocks[6] << 16 | static_cast<uint32_t>(blocks[7]) << 24;
+            for (unsigned int i = 0; i < 16; ++i)
+            {
+                unsigned int x = bx + i % 4, y = by + i / 4;
+                if (x >= width || y >= height)
+                    continue;
+                const int* color = palette[(indices >> (2 * i)) & 3];
+                for (int c = 0; c < 3; ++c)
+                    rgb[(y * width + x) * 3 + c] = static_cast<unsigned char>(color[c]);
+            }
+            blocks += 8;
+        }
+    }
+}
+
+bool CookTexture(const FileView& source, bool compress, std::vector<char>& cooked)
+{
+    // grey images become RGB(A), the formats the game uploads
+    int width, height, channels;
+    const stbi_uc* encoded = reinterpret_cast<const stbi_uc*>(source.Data);
+    if (!stbi_info_from_memory(encoded, static_cast<int>(source.Size), &width, &height, &channels))
+        return false;
+    channels = channels == 2 || channels == 4 ? 4 : 3;
+    unsigned char* pixels = stbi_load_from_memory(encoded, static_cast<int>(source.Size), &width, &height, &channels, channels);
+    if (!pixels)
+        return false;
+    channels = channels == 2 || channels == 4 ? 4 : 3;
+    // only opaque images can go to BC1, which has no alpha worth keeping
+    bool opaque = true;
+    for (int i = 0; channels == 4 && opaque && i < width * height; ++i)
+        opaque = pixels[i * 4 + 3] == 255;
+
+    CookedTextureHeader header = CookedTextureHeader();
+    std::memcpy(header.Magic, COOKED_TEXTURE_MAGIC, 4);
+    header.Version = COOKED_TEXTURE_VERSION;
+    header.Width = width;
+    header.Height = height;
+    header.Format = compress && opaque ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : channels == 4 ? GL_RGBA : GL_RGB;
+    header.Levels = 1; // sprites are drawn with GL_LINEAR minification, so a mip chain would only take up memory
+    header.SourceSize = static_cast<uint32_t>(source.Size);
+    header.SourceHash = CookedSourceHash(source);
+    unsigned int size = Texture2D::ImageSize(header.Format, width, height);
+    cooked.resize(sizeof(header) + size);
+    std::memcpy(cooked.data(), &header, sizeof(header));
+    unsigned char* payload = reinterpret_cast<unsigned char*>(cooked.data() + sizeof(header));
+    if (header.Format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+        compressBC1(pixels, channels, width, height, payload);
+    else
+        std::memcpy(payload, pixels, size);
+    stbi_image_free(pixels);
+    return true;
+}
+
+int CookTextures(const std::string& root, const std::string& folder, bool compress)
+{
+    std::vector<std::string> files;
+    if (!ListFiles(root + "/" + folder, files))
+    {
+        std::cout << "ERROR::COOK: Failed to list " << root << "/" << folder << std::endl;
+        return -1;
+    }
+    DirectoryMount source(root);
+    int cooked = 0;
+    for (const std::string& file : files)
+    {
+        std::string extension = file.substr(std::min(file.find_last_of('.'), file.size()));
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(std::tolower(c)); });
+        if (extension != ".png" && extension != ".jpg" && extension != ".jpeg")
+            continue;
+        std::string path = folder + "/" + file;
+        std::vector<char> encoded, texture;
+        FileView view;
+        if (source.Read(path, encoded))
+        {
+            view.Data = encoded.data();
+            view.Size = encoded.size();
+        }
+        if (encoded.empty() || !CookTexture(view, compress, texture))
+        {
+            std::cout << "ERROR::COOK: Failed to decode " << root << "/" << path << std::endl;
+            return -1;
+        }
+        std::ofstream out(source.NativePath(CookedTexturePath(path)), std::ios::binary);
+        out.write(texture.data(), texture.size());
+        if (!out)
+        {
+            std::cout << "ERROR::COOK: Failed to write " << source.NativePath(CookedTexturePath(path)) << std::endl;
+            return -1;
+        }
+        ++cooked;
+    }
+    return cooked;
+}
@@ -0,0 +1,62 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef COOKED_TEXTURE_H
+#define COOKED_TEXTURE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "file_system.h"
+
+
+// Cooked texture layout (little-endian): a 32-byte header followed by
+// the pixels of every mip level, largest first, each tightly packed in
+// the row order glTexImage2D takes them. Format is the GL format of the
+// pixels: GL_RGB or GL_RGBA bytes, or BC1 blocks
+// (GL_COMPRESSED_RGB_S3TC_DXT1_EXT).
+struct CookedTextureHeader {
+    char     Magic[4];     // "BTEX"
+    uint32_t Version;
+    uint32_t Width, Height;
+    uint32_t Format;
+    uint32_t Levels;
+    uint32_t SourceSize;   // of the encoded image it was cooked from,
+    uint32_t SourceHash;   // and its CookedSourceHash; a source that differs makes the cooked file stale
+};
+
+const uint32_t COOKED_TEXTURE_VERSION = 2;
+// largest width or height a cooked texture may have
+const uint32_t MAX_COOKED_TEXTURE_SIZE = 16384;
+
+
+// A cooked texture viewed in place; Data covers all levels
+struct CookedTexture {
+    unsigned int         Width, Height;
+    unsigned int         Format;
+    unsigned int         Levels;
+    uint32_t             SourceSize, SourceHash;
+    const unsigned char* Data;
+    size_t               Size;
+};
+
+// where the cooked version of a source image lives: the same path with a .tex extension
+std::string CookedTexturePath(const std::string& source);
+// FNV-1a hash of an encoded source image, as recorded in the files cooked from it
+uint32_t CookedSourceHash(const FileView& source);
+// checks a cooked file and points texture at its pixels; false if it isn't a valid cooked texture
+bool ParseCookedTexture(const FileView& file, CookedTexture& texture);
+// decodes an encoded source image (PNG, JPEG, ...) into a cooked file; BC1 compresses it if asked and the image is opaque
+bool CookTexture(const FileView& source, bool compress, std::vector<char>& cooked);
+// expands BC1 blocks to RGB bytes (for the atlas, or drivers without S3TC support)
+void DecompressBC1(const unsigned char* blocks, unsigned int width, unsigned int height, unsigned char* rgb);
+// writes a cooked file next to every image in the given folder of root; returns the number cooked, or -1 on failure
+int CookTextures(const std::string& root, const std::string& folder, bool compress);
+
+#endif
@@ -0,0 +1,125 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include "file_system.h"
+
+#include <fstream>
+#include <iostream>
+
+// Instantiate static variables
+std::vector<std::unique_ptr<FileMount>>  FileSystem::mounts;
+std::map<std::string, const FileMount*>  FileSystem::resolved;
+std::mutex                               FileSystem::resolvedLock;
+unsigned int                             FileSystem::Lookups = 0;
+unsigned int                             FileSystem::Misses = 0;
+
+
+DirectoryMount::DirectoryMount(const std::string& root)
+    : root(root)
+{
+    if (!this->root.empty() && this->root.back() != '/' && this->root.back() != '\\')
+        this->root += '/';
+}
+
+bool DirectoryMount::Exists(const std::string& path) const
+{
+    return static_cast<bool>(std::ifstream(this->NativePath(path), std::ios::binary));
+}
+
+bool DirectoryMount::Read(const std::string& path, std::vector<char>& data) const
+{
+    std::ifstream file(this->NativePath(path), std::ios::binary | std::ios::ate);
+    if (!file)
+        return false;
+    std::streamoff size = file.tellg();
+    file.seekg(0);
+    data.resize(static_cast<size_t>(size));
+    return size == 0 || static_cast<bool>(file.read(data.data(), size));
+}
+
+std::string DirectoryMount::NativePath(const std::string& path) const
+{
+    return this->root + path;
+}
+
+void FileSystem::Mount(std::unique_ptr<FileMount> mount)
+{
+    std::lock_guard<std::mutex> lock(resolvedLock);
+    mounts.push_back(std::move(mount));
+    resolved.clear();
+}
+
+void FileSystem::MountDirectory(const std::string& root)
+{
+    Mount(std::unique_ptr<FileMount>(new DirectoryMount(root)));
+}
+
+void FileSystem::Clear()
+{
+    std::lock_guard<std::mutex> lock(resolvedLock);
+    mounts.clear();
+    resolved.clear();
+}
+
+bool FileSystem::Exists(const std::string& path)
+{
+    return resolve(path) != nullptr;
+}
+
+bool FileSystem::ReadFile(const std::string& path, std::vector<char>& data)
+{
+    const FileMount* mount = resolve(path);
+    if (!mount || !mount->Read(path, data))
+    {
+        std::cout << "ERROR::FILESYSTEM: Failed to read " << path << std::endl;
+        data.clear();
+        return false;
+    }
+    return true;
+}
+
+bool FileSystem::ViewFile(const std::string& path, FileView& view, std::vector<char>& storage)
+{
+    const FileMount* mount = resolve(path);
+    if (mount && mount->View(path, view))
+        return true;
+    bool ok = ReadFile(path, storage);
+    view.Data = storage.data();
+    view.Size = storage.size();
+    return ok;
+}
+
+bool FileSystem::ReadText(const std::string& path, std::string& text)
+{
+    std::vector<char> data;
+    bool ok = ReadFile(path, data);
+    text.assign(data.begin(), data.end());
+    return ok;
+}
+
+const FileMount* FileSystem::resolve(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(resolvedLock);
+    ++Lookups;
+    std::map<std::string, const FileMount*>::const_iterator it = resolved.find(path);
+    if (it != resolved.end())
+        return it->second;
+    // first lookup of this path: the first mount holding it wins
+    ++Misses;
+    const FileMount* found = nullptr;
+    for (const std::unique_ptr<FileMount>& mount : mounts)
+    {
+        if (mount->Exists(path))
+        {
+            found = mount.get();
+            break;
+        }
+    }
+    resolved[path] = found;
+    return found;
+}
@@ -0,0 +1,91 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef FILE_SYSTEM_H
+#define FILE_SYSTEM_H
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+// A read-only view of a file's bytes (std::span style); valid as long as
+// the mount (or the storage buffer) it points into
+struct FileView {
+    const char* Data;
+    size_t      Size;
+    const char* begin() const { return this->Data; }
+    const char* end() const { return this->Data + this->Size; }
+};
+
+// A source of files for the FileSystem, addressed by logical path
+// (forward slashes, relative to the mount, e.g. "levels/one.lvl")
+class FileMount
+{
+public:
+    virtual ~FileMount() { }
+    // whether the mount holds the file
+    virtual bool Exists(const std::string& path) const = 0;
+    // reads the whole file; false if it can't be read
+    virtual bool Read(const std::string& path, std::vector<char>& data) const = 0;
+    // points a view straight at the file's bytes if the mount keeps them in memory; false otherwise
+    virtual bool View(const std::string& /*path*/, FileView& /*view*/) const { return false; }
+};
+
+// A directory on disk as a mount
+class DirectoryMount : public FileMount
+{
+public:
+    // constructor (root is a native path, with or without a trailing slash)
+    DirectoryMount(const std::string& root);
+    bool Exists(const std::string& path) const override;
+    bool Read(const std::string& path, std::vector<char>& data) const override;
+    // native path of a file of the mount
+    std::string NativePath(const std::string& path) const;
+private:
+    std::string root;
+};
+
+
+// A static singleton FileSystem that resolves the logical paths of
+// all assets against an ordered list of mounts: the first mount that
+// holds a path serves it. Which mount serves a path is cached, so
+// every path is only searched for once; changing the mounts drops the
+// cache. Lookups are thread-safe, mounting is meant for start-up.
+class FileSystem
+{
+public:
+    // appends a mount; it is searched after the ones mounted before it
+    static void Mount(std::unique_ptr<FileMount> mount);
+    static void MountDirectory(const std::string& root);
+    // removes all mounts
+    static void Clear();
+    // whether any mount holds the file
+    static bool Exists(const std::string& path);
+    // reads a whole file; prints an error and returns false if no mount holds it
+    static bool ReadFile(const std::string& path, std::vector<char>& data);
+    static bool ReadText(const std::string& path, std::string& text);
+    // views a whole file: directly in the mount's memory when it can (packs), otherwise read into storage
+    static bool ViewFile(const std::string& path, FileView& view, std::vector<char>& storage);
+    // resolved-path lookups since start-up, and how many of them had to search the mounts
+    static unsigned int Lookups, Misses;
+private:
+    // private constructor, that is we do not want any actual file system objects. Its members and functions should be publicly available (static).
+    FileSystem() { }
+    // the mount serving a path, or nullptr
+    static const FileMount* resolve(const std::string& path);
+    // state
+    static std::vector<std::unique_ptr<FileMount>> mounts;
+    static std::map<std::string, const FileMount*> resolved; // nullptr for paths no mount holds
+    static std::mutex                              resolvedLock;
+};
+
+#endif
@@ -0,0 +1,39 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include "frame_uniforms.h"
+
+#include <cstddef>
+
+
+// the std140 offsets of the block; FrameData must not gain padding of its own
+static_assert(offsetof(FrameData, Time) == 64 && offsetof(FrameData, Shake) == 76 && sizeof(FrameData) == 80,
+    "FrameData must match the std140 layout of the FrameData block");
+
+FrameUniforms::FrameUniforms()
+    : Data()
+{
+    this->Data.Projection = glm::mat4(1.0f);
+    glGenBuffers(1, &this->UBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, this->UBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), &this->Data, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, this->UBO);
+}
+
+FrameUniforms::~FrameUniforms()
+{
+    glDeleteBuffers(1, &this->UBO);
+}
+
+void FrameUniforms::Upload()
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, this->UBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &this->Data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
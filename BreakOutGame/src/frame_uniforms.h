@@ -0,0 +1,58 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+
+// Frame-global shader data, laid out as the std140 FrameData block
+// every shader in src/shaders declares (keep both in sync):
+//
+//     layout (std140) uniform FrameData {
+//         mat4  projection;
+//         float time;
+//         bool  confuse;
+//         bool  chaos;
+//         bool  shake;
+//     };
+struct FrameData {
+    glm::mat4 Projection; // offset 0
+    float     Time;       // offset 64, seconds since the window opened
+    int       Confuse;    // offset 68, GLSL bools are 4 bytes in std140
+    int       Chaos;      // offset 72
+    int       Shake;      // offset 76
+};
+
+// name of the block in the shaders, and the uniform buffer binding point it is bound to
+const char* const  FRAME_DATA_BLOCK = "FrameData";
+const unsigned int FRAME_DATA_BINDING = 0;
+
+
+// FrameUniforms owns the uniform buffer behind the FrameData block.
+// Programs bind their FrameData block to FRAME_DATA_BINDING when they
+// are linked (see Shader::Compile), so a single Upload per frame
+// reaches every shader.
+class FrameUniforms
+{
+public:
+    // data of the next Upload
+    FrameData Data;
+    // constructor (creates the buffer and binds it to FRAME_DATA_BINDING)
+    FrameUniforms();
+    // destructor
+    ~FrameUniforms();
+    // uploads Data
+    void Upload();
+private:
+    unsigned int UBO;
+};
+
+#endif
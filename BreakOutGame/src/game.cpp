@@ -14,130 +14,335 @@
 #include "post_processor.h"
 #include <irrklang/irrKlang.h>
 #include "text_renderer.h"
+#include "frame_uniforms.h"
+#include "collision.h"
+#include "file_system.h"
+#include "job_system.h"
+#include <algorithm>
+#include <cassert>
 #include <sstream>
 
 
-// Game-related State data
-SpriteRenderer  *Renderer;
-GameObject* Player;
-PostProcessor* Effects;
-
 using namespace irrklang;
-ISoundEngine* SoundEngine = createIrrKlangDevice();
 
 // Initial velocity of the Ball
 const glm::vec2 INITIAL_BALL_VELOCITY(100.0f, -350.0f);
 // Radius of the ball object
 const float BALL_RADIUS = 12.5f;
-float ShakeTime = 0.0f;
-BallObject* Ball;
+// Maximum number of contacts a ball resolves in a single step
+const unsigned int MAX_BALL_COLLISIONS = 8;
+// Only this many balls leave a particle trail; the pool is too small to share among more
+const unsigned int MAX_BALL_TRAILS = 4;
 
 Game::Game(unsigned int width, unsigned int height) 
-    : State(GAME_ACTIVE), Keys(), Width(width), Height(height), Level(0), Lives(3)
+    : State(GAME_ACTIVE), Keys(), KeysProcessed(), Width(width), Height(height), Level(0), Lives(3), Confuse(false), Chaos(false), Shake(false), Headless(false), GpuParticles(false), AntiAliasing(AA_MSAA_4X), Stats(), Rendered(),
+      renderer(nullptr), player(nullptr), effects(nullptr), particles(nullptr), text(nullptr), frameUniforms(nullptr), levelSprites(nullptr), levelSpritesLevel(0), livesText(nullptr), menuText(), winText(), livesShown(0), soundEngine(nullptr), shakeTime(0.0f)
 { 
-
+    this->Seed(0);
 }
 
 Game::~Game()
 {
-    delete Renderer;
-    delete Player;
+    delete this->renderer;
+    delete this->player;
+    delete this->effects;
+    delete this->particles;
+    delete this->text;
+    delete this->frameUniforms;
+    delete this->levelSprites;
+    delete this->livesText;
+    for (TextObject* text : this->menuText)
+        delete text;
+    for (TextObject* text : this->winText)
+        delete text;
+    if (this->soundEngine)
+        this->soundEngine->drop();
 }
 
-ParticleGenerator* Particles;
-TextRenderer* Text;
+void Game::playAudio(const char* file, bool looped)
+{
+    if (!this->soundEngine)
+        return;
+    // sounds are read through the file system once and then kept by irrKlang under their logical path
+    if (!this->soundEngine->getSoundSource(file, false))
+    {
+        FileView data;
+        std::vector<char> storage;
+        if (!FileSystem::ViewFile(file, data, storage))
+            return;
+        this->soundEngine->addSoundSourceFromMemory(const_cast<char*>(data.Data), static_cast<ik_s32>(data.Size), file);
+    }
+    this->soundEngine->play2D(file, looped);
+}
 
 void Game::Init()
 {
+    if (this->Headless)
+    {
+        if (this->Levels.empty())
+            this->LoadLevels();
+        this->initSimulation();
+        this->particles = new ParticleGenerator(500);
+        this->particles->Seed(this->seed);
+        return;
+    }
+
+    // decoding images, parsing levels and rasterizing the font need no GL context, so they run on
+    // workers while this thread compiles the shaders; only the uploads below stay on the GL thread
+    JobSystem jobs;
+    std::vector<PendingTexture> textures = {
+        { "textures/background.jpg", "background", false, false },
+        { "textures/particle.png", "particle", true, false },
+        // everything drawn by the sprite renderer on top of the background shares the atlas, so it batches into one draw
+        { "textures/awesomeface.png", "face", true, true },
+        { "textures/block.png", "block", false, true },
+        { "textures/block_solid.png", "block_solid", false, true },
+        { "textures/paddle.png", "paddle", true, true },
+        { "textures/powerup_speed.png", "powerup_speed", true, true },
+        { "textures/powerup_sticky.png", "powerup_sticky", true, true },
+        { "textures/powerup_increase.png", "powerup_increase", true, true },
+        { "textures/powerup_confuse.png", "powerup_confuse", true, true },
+        { "textures/powerup_chaos.png", "powerup_chaos", true, true },
+        { "textures/powerup_passthrough.png", "powerup_passthrough", true, true },
+    };
+    for (PendingTexture& texture : textures)
+        jobs.Submit([&texture]() { ResourceManager::DecodeTexture(texture); });
+    GlyphAtlasImage glyphs;
+    jobs.Submit([&glyphs]() { TextRenderer::Rasterize("fonts/OCRAEXT.TTF", 24, glyphs); });
+    this->LoadLevels(&jobs);
 
     // load shaders
-    ResourceManager::LoadShader("C:/cz/BO/BreakOutGame/BreakOutGame/src/shaders/sprite.vs", "C:/cz/BO/BreakOutGame/BreakOutGame/src/shaders/sprite.frag", nullptr, "sprite");
-    ResourceManager::LoadShader("C:/cz/BO/BreakOutGame/BreakOutGame/src/shaders/particle.vs", "C:/cz/BO/BreakOutGame/BreakOutGame/src/shaders/particle.frag", nullptr, "particle");
-    ResourceManager::LoadShader("C:/cz/BO/BreakOutGame/BreakOutGame/src/shaders/post_processing.vs", "C:/cz/BO/BreakOutGame/BreakOutGame/src/shaders/post_processing.frag", nullptr, "postprocessing");
+    ResourceManager::LoadShader("shaders/sprite.vs", "shaders/sprite.frag", nullptr, "sprite");
+    ResourceManager::LoadShader("shaders/particle.vs", "shaders/particle.frag", nullptr, "particle");
+    ResourceManager::LoadShader("shaders/post_processing.vs", "shaders/post_processing.frag", nullptr, "postprocessing");
+    ResourceManager::LoadShader("shaders/post_processing.vs", "shaders/fxaa.frag", nullptr, "fxaa");
 
 
-    // configure shaders
-    glm::mat4 projection = glm::ortho(0.0f, static_cast<float>(this->Width), 
+    // configure shaders; the projection is shared by all of them through the frame uniforms
+    this->frameUniforms = new FrameUniforms();
+    this->frameUniforms->Data.Projection = glm::ortho(0.0f, static_cast<float>(this->Width), 
         static_cast<float>(this->Height), 0.0f, -1.0f, 1.0f);
-    ResourceManager::GetShader("sprite").Use().SetInteger("image", 0);
-    ResourceManager::GetShader("sprite").SetMatrix4("projection", projection);
-    ResourceManager::GetShader("particle").Use().SetMatrix4("projection", projection);
+    this->frameUniforms->Upload();
 
     // set render-specific controls
 
-    // Renderer = new SpriteRenderer(ResourceManager::GetShader("sprite"));
+    // this->renderer = new SpriteRenderer(ResourceManager::GetShader("sprite"));
 
     Shader myShader = ResourceManager::GetShader("sprite");
-    Renderer = new SpriteRenderer(myShader);
-    
-    // load textures
-    ResourceManager::LoadTexture("C:/cz/BO/BreakOutGame/BreakOutGame/src/textures/awesomeface.png", true, "face");
-    ResourceManager::LoadTexture("C:/cz/BO/BreakOutGame/BreakOutGame/src/textures/background.jpg", false, "background");
-    ResourceManager::LoadTexture("C:/cz/BO/BreakOutGame/BreakOutGame/src/textures/awesomeface.png", true, "face");
-    ResourceManager::LoadTexture("C:/cz/BO/BreakOutGame/BreakOutGame/src/textures/block.png", false, "block");
-    ResourceManager::LoadTexture("C:/cz/BO/BreakOutGame/BreakOutGame/src/textures/block_solid.png", false, "block_solid");
-    ResourceManager::LoadTexture("C:/cz/BO/BreakOutGame/BreakOutGame/src/textures/paddle.png", true, "paddle");
-    ResourceManager::LoadTexture("C:/cz/BO/BreakOutGame/BreakOutGame/src/textures/particle.png", true, "particle");
-    ResourceManager::LoadTexture("C:/cz/BO/BreakOutGame/BreakOutGame/src/textures/powerup_speed.png", true, "powerup_speed");
-    ResourceManager::LoadTexture("C:/cz/BO/BreakOutGame/BreakOutGame/src/textures/powerup_sticky.png", true, "powerup_sticky");
-    ResourceManager::LoadTexture("C:/cz/BO/BreakOutGame/BreakOutGame/src/textures/powerup_increase.png", true, "powerup_increase");
-    ResourceManager::LoadTexture("C:/cz/BO/BreakOutGame/BreakOutGame/src/textures/powerup_confuse.png", true, "powerup_confuse");
-    ResourceManager::LoadTexture("C:/cz/BO/BreakOutGame/BreakOutGame/src/textures/powerup_chaos.png", true, "powerup_chaos");
-    ResourceManager::LoadTexture("C:/cz/BO/BreakOutGame/BreakOutGame/src/textures/powerup_passthrough.png", true, "powerup_passthrough");
-
-
-    // load levels
-    GameLevel one; one.Load("C:/cz/BO/BreakOutGame/BreakOutGame/src/levels/one.lvl", this->Width, this->Height / 2);
-    GameLevel two; two.Load("C:/cz/BO/BreakOutGame/BreakOutGame/src/levels/two.lvl", this->Width, this->Height / 2);
-    GameLevel three; three.Load("C:/cz/BO/BreakOutGame/BreakOutGame/src/levels/three.lvl", this->Width, this->Height / 2);
-    GameLevel four; four.Load("C:/cz/BO/BreakOutGame/BreakOutGame/src/levels/four.lvl", this->Width, this->Height / 2);
-    this->Levels.push_back(one);
-    this->Levels.push_back(two);
-    this->Levels.push_back(three);
-    this->Levels.push_back(four);
+    this->renderer = new SpriteRenderer(myShader);
+    this->levelSprites = new SpriteBuffer();
+
+    // upload textures, in the order they were listed
+    jobs.Wait();
+    for (PendingTexture& texture : textures)
+        ResourceManager::UploadTexture(texture);
+    ResourceManager::BuildAtlas();
+
+    this->initSimulation();
 
+    if (this->GpuParticles)
+    {
+        Shader update = ResourceManager::LoadFeedbackShader("shaders/particle_update.vs",
+            { "outPosition", "outVelocity", "outColor", "outLife" }, "particle_update");
+        this->particles = new ParticleGenerator(ResourceManager::GetShader("particle"), ResourceManager::GetTexture("particle"), 500, update);
+    }
+    else
+        this->particles = new ParticleGenerator(ResourceManager::GetShader("particle"),ResourceManager::GetTexture("particle"),500);
+    this->particles->Seed(this->seed);
+
+    this->effects = new PostProcessor(ResourceManager::GetShader("postprocessing"), ResourceManager::GetShader("fxaa"), this->Width, this->Height, this->AntiAliasing);
+
+    // irrKlang returns null when there is no audio device; the game then just runs silent
+    this->soundEngine = createIrrKlangDevice();
+    if (this->soundEngine)
+        this->soundEngine->setSoundVolume(0.25f);
+    this->playAudio("audio/breakout.mp3", true);
+
+    this->text = new TextRenderer();
+    this->text->Upload(glyphs);
+    // the strings shown on screen are laid out once and only again when they change
+    this->livesText = new TextObject();
+    this->livesText->SetPosition(5.0f, 5.0f);
+    for (TextObject*& text : this->menuText)
+        text = new TextObject();
+    this->menuText[0]->SetText("Press ENTER to start");
+    this->menuText[0]->SetPosition(250.0f, this->Height / 2.0f);
+    this->menuText[1]->SetText("Press W or S to select level");
+    this->menuText[1]->SetPosition(245.0f, this->Height / 2.0f + 20.0f, 0.75f);
+    for (TextObject*& text : this->winText)
+        text = new TextObject();
+    this->winText[0]->SetText("You WON!!!");
+    this->winText[0]->SetPosition(320.0f, this->Height / 2.0f - 20.0f);
+    this->winText[0]->SetColor(glm::vec3(0.0f, 1.0f, 0.0f));
+    this->winText[1]->SetText("Press ENTER to retry or ESC to quit");
+    this->winText[1]->SetPosition(130.0f, this->Height / 2.0f);
+    this->winText[1]->SetColor(glm::vec3(1.0f, 1.0f, 0.0f));
+
+}
+
+void Game::LoadLevels(JobSystem* jobs)
+{
+    static const char* files[] = { "levels/one.lvl", "levels/two.lvl", "levels/three.lvl", "levels/four.lvl" };
+    const unsigned int count = sizeof(files) / sizeof(files[0]);
+    // every level parses into its own slot, so they can load in parallel
+    this->Levels.assign(count, GameLevel());
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        GameLevel* level = &this->Levels[i];
+        const char* file = files[i];
+        unsigned int width = this->Width, height = this->Height / 2;
+        if (jobs)
+            jobs->Submit([level, file, width, height]() { level->Load(file, width, height); });
+        else
+            level->Load(file, width, height);
+    }
+}
+
+void Game::initSimulation()
+{
+    this->backgroundTexture = ResourceManager::FindTexture("background");
+    this->ballTexture = ResourceManager::FindTexture("face");
+    this->speedTexture = ResourceManager::FindTexture("powerup_speed");
+    this->stickyTexture = ResourceManager::FindTexture("powerup_sticky");
+    this->passThroughTexture = ResourceManager::FindTexture("powerup_passthrough");
+    this->increaseTexture = ResourceManager::FindTexture("powerup_increase");
+    this->confuseTexture = ResourceManager::FindTexture("powerup_confuse");
+    this->chaosTexture = ResourceManager::FindTexture("powerup_chaos");
 
     glm::vec2 playerPos = glm::vec2(this->Width / 2.0f - PLAYER_SIZE.x / 2.0f, this->Height - PLAYER_SIZE.y);
-    Player = new GameObject(playerPos, PLAYER_SIZE, ResourceManager::GetTexture("paddle"));
+    this->player = new GameObject(playerPos, PLAYER_SIZE, ResourceManager::FindTexture("paddle"));
 
     glm::vec2 ballPos = playerPos + glm::vec2(PLAYER_SIZE.x / 2.0f - BALL_RADIUS, -BALL_RADIUS * 2.0f);
 
-    Ball = new BallObject(ballPos, BALL_RADIUS, INITIAL_BALL_VELOCITY, ResourceManager::GetTexture("face"));
+    this->Balls.push_back(BallObject(ballPos, BALL_RADIUS, INITIAL_BALL_VELOCITY, this->ballTexture));
+}
+
+BallObject& Game::GetBall()
+{
+    // only empty before Init; losing the last ball respawns one
+    assert(!this->Balls.empty());
+    return this->Balls.front();
+}
+
+void Game::SpawnBall(glm::vec2 position, glm::vec2 velocity)
+{
+    BallObject ball(position, BALL_RADIUS, velocity, this->ballTexture);
+    ball.Stuck = false;
+    this->Balls.push_back(ball);
+}
+
+GameObject& Game::GetPlayer()
+{
+    return *this->player;
+}
+
+// FNV-1a over the raw bytes of a value
+template <typename T>
+static void hashValue(uint32_t& hash, const T& value)
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+    for (size_t i = 0; i < sizeof(T); ++i)
+        hash = (hash ^ bytes[i]) * 16777619u;
+}
 
-    Particles = new ParticleGenerator(ResourceManager::GetShader("particle"),ResourceManager::GetTexture("particle"),500);
+void Game::Seed(uint64_t seed)
+{
+    this->seed = seed;
+    this->spawnRandom.Seed(seed, "spawn");
+    if (this->particles)
+        this->particles->Seed(seed);
+}
 
-    Effects = new PostProcessor(ResourceManager::GetShader("postprocessing"), this->Width, this->Height);
+uint32_t Game::Checksum() const
+{
+    // everything a tick reads or writes; floats are hashed bitwise, so any difference shows
+    uint32_t hash = 2166136261u;
+    hashValue(hash, this->State);
+    hashValue(hash, this->Level);
+    hashValue(hash, this->Lives);
+    hashValue(hash, this->Confuse);
+    hashValue(hash, this->Chaos);
+    hashValue(hash, this->Shake);
+    hashValue(hash, this->shakeTime);
+    hashValue(hash, this->spawnRandom);
+    hashValue(hash, this->player->Position);
+    hashValue(hash, this->player->Size);
+    for (const BallObject& ball : this->Balls)
+    {
+        hashValue(hash, ball.Position);
+        hashValue(hash, ball.Velocity);
+        hashValue(hash, ball.Stuck);
+        hashValue(hash, ball.Sticky);
+        hashValue(hash, ball.PassThrough);
+    }
+    for (const PowerUp& powerUp : this->PowerUps)
+    {
+        hashValue(hash, powerUp.Position);
+        hashValue(hash, powerUp.Duration);
+        hashValue(hash, powerUp.Activated);
+        hashValue(hash, powerUp.Destroyed);
+        for (char c : powerUp.Type)
+            hashValue(hash, c);
+    }
+    for (const GameLevel& level : this->Levels)
+        for (uint32_t word : level.DestroyedMask)
+            hashValue(hash, word);
+    return hash;
+}
 
-    SoundEngine->setSoundVolume(0.25f);
-    SoundEngine->play2D("C:/cz/BO/BreakOutGame/BreakOutGame/src/audio/breakout.mp3", true);
+void Game::Step(float dt)
+{
+    // remember where everything was so Render can interpolate towards the new state
+    for (BallObject& ball : this->Balls)
+        ball.PrevPosition = ball.Position;
+    this->player->PrevPosition = this->player->Position;
+    for (PowerUp& powerUp : this->PowerUps)
+        powerUp.PrevPosition = powerUp.Position;
 
-    Text = new TextRenderer(this->Width, this->Height);
-    Text->Load("C:/cz/BO/BreakOutGame/BreakOutGame/src/fonts/ocraext.TTF", 24);
+    this->ProcessInput(dt);
+    this->Update(dt);
+}
 
+void Game::EndFrame()
+{
+    for (GameLevel& level : this->Levels)
+        level.ClearChanges();
+}
 
+void Game::SetAntiAliasing(AntiAliasingMode mode)
+{
+    this->AntiAliasing = mode;
+    if (this->effects)
+        this->effects->SetAntiAliasing(mode);
 }
 
 void Game::Update(float dt)
 {
-    // update objects
-    Ball->Move(dt, this->Width);
-    // check for collisions
-    this->DoCollisions();
+    // update objects and check for collisions
+    this->DoCollisions(dt);
 
     //update particles
-    Particles->Update(dt, *Ball, 2, glm::vec2(Ball->Radius / 2.0f));
+    for (unsigned int i = 0; i < this->Balls.size() && i < MAX_BALL_TRAILS; ++i)
+        this->particles->Emit(this->Balls[i], 2, glm::vec2(this->Balls[i].Radius / 2.0f));
+    this->particles->Update(dt);
     this->UpdatePowerUps(dt);
 
-    if (ShakeTime > 0.0f)
+    if (this->shakeTime > 0.0f)
     {
-        ShakeTime -= dt;
-        if (ShakeTime <= 0.0f)
-            Effects->Shake = false;
+        this->shakeTime -= dt;
+        if (this->shakeTime <= 0.0f)
+            this->Shake = false;
     }
 
-    if (Ball->Position.y >= this->Height) // did ball reach bottom edge?
+    // drop the balls that reached the bottom edge; a life is only lost with the last one
+    unsigned int height = this->Height;
+    this->Balls.erase(std::remove_if(this->Balls.begin(), this->Balls.end(),
+        [height](const BallObject& ball) { return ball.Position.y >= height; }
+    ), this->Balls.end());
+    if (this->Balls.empty())
     {
         --this->Lives;
+        ++this->Stats.LivesLost;
         if (this->Lives == 0) {
             this->ResetLevel();
             this->State = GAME_MENU;
@@ -147,9 +352,10 @@ void Game::Update(float dt)
     }
     if (this->State == GAME_ACTIVE && this->Levels[this->Level].IsCompleted())
     {
+        ++this->Stats.LevelsCompleted;
         this->ResetLevel();
         this->ResetPlayer();
-        Effects->Chaos = true;
+        this->Chaos = true;
         this->State = GAME_WIN;
     }
 
@@ -184,7 +390,7 @@ void Game::ProcessInput(float dt)
         if (this->Keys[GLFW_KEY_ENTER])
         {
             this->KeysProcessed[GLFW_KEY_ENTER] = true;
-            Effects->Chaos = false;
+            this->Chaos = false;
             this->State = GAME_MENU;
         }
     }
@@ -194,143 +400,138 @@ void Game::ProcessInput(float dt)
         // move playerboard
         if (this->Keys[GLFW_KEY_A])
         {
-            if (Player->Position.x >= 0.0f)
+            if (this->player->Position.x >= 0.0f)
             {
-                Player->Position.x -= velocity;
-                if (Ball->Stuck)
-                    Ball->Position.x -= velocity;
+                this->player->Position.x -= velocity;
+                for (BallObject& ball : this->Balls)
+                    if (ball.Stuck)
+                        ball.Position.x -= velocity;
             }
         }
         if (this->Keys[GLFW_KEY_D])
         {
-            if (Player->Position.x <= this->Width - Player->Size.x)
+            if (this->player->Position.x <= this->Width - this->player->Size.x)
             {
-                Player->Position.x += velocity;
-                if (Ball->Stuck)
-                    Ball->Position.x += velocity;
+                this->player->Position.x += velocity;
+                for (BallObject& ball : this->Balls)
+                    if (ball.Stuck)
+                        ball.Position.x += velocity;
             }
         }
         if (this->Keys[GLFW_KEY_SPACE])
-            Ball->Stuck = false;
+            for (BallObject& ball : this->Balls)
+                ball.Stuck = false;
     }
 
 
 }
 
-void Game::Render()
+void Game::Render(float alpha)
 {
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
-    Texture2D backgroundText = ResourceManager::GetTexture("background");
+    this->renderer->ResetStats();
+    this->particles->DrawCalls = 0;
+    this->text->DrawCalls = 0;
+    this->text->Layouts = 0;
+    this->effects->DrawCalls = 0;
+
+    // everything frame-global goes to the shaders in one upload
+    this->frameUniforms->Data.Time = static_cast<float>(glfwGetTime());
+    this->frameUniforms->Data.Confuse = this->Confuse;
+    this->frameUniforms->Data.Chaos = this->Chaos;
+    this->frameUniforms->Data.Shake = this->Shake;
+    this->frameUniforms->Upload();
+
+    // the bricks stay on the GPU: a new level is uploaded once, after that only changed bricks are patched
+    GameLevel& level = this->Levels[this->Level];
+    if (this->levelSprites->Count() == 0 || this->levelSpritesLevel != this->Level)
+    {
+        level.Build(*this->levelSprites);
+        this->renderer->Upload(*this->levelSprites);
+        this->levelSpritesLevel = this->Level;
+    }
+    else
+        level.Sync(*this->levelSprites);
 
     if (this->State == GAME_ACTIVE || this->State == GAME_MENU)
     {
-        Effects->BeginRender();
+        // the offscreen round trip is only needed while an effect is on
+        this->effects->BeginRender(this->Confuse || this->Chaos || this->Shake);
+        // sprites are batched until the particles change the blend state
+        this->renderer->Begin();
         // draw background
-        Renderer->DrawSprite(backgroundText,
+        this->renderer->Submit(ResourceManager::GetTexture(this->backgroundTexture),
             glm::vec2(0.0f, 0.0f), glm::vec2(this->Width, this->Height), 0.0f
         );
         // draw level
-        this->Levels[this->Level].Draw(*Renderer);
+        this->renderer->Draw(*this->levelSprites);
 
         // draw player
-        Player->Draw(*Renderer);
+        this->player->Draw(*this->renderer, alpha);
 
         for (PowerUp& powerUp : this->PowerUps)
             if (!powerUp.Destroyed)
-                powerUp.Draw(*Renderer);
+                powerUp.Draw(*this->renderer, alpha);
+
+        this->renderer->Flush();
 
         // draw particles
-        Particles->Draw();
-
-        // draw ball
-        Ball->Draw(*Renderer);
-        Effects->EndRender();
-        Effects->Render(glfwGetTime());
-        std::stringstream ss; ss << this->Lives;
-        Text->RenderText("Lives:" + ss.str(), 5.0f, 5.0f, 1.0f);
+        this->particles->Draw();
+
+        // draw balls
+        this->renderer->Begin();
+        for (BallObject& ball : this->Balls)
+            ball.Draw(*this->renderer, alpha);
+        this->renderer->Flush();
+        this->effects->EndRender();
+        this->effects->Render();
+        // the string is only rebuilt when the count changes
+        if (this->livesText->GetText().empty() || this->livesShown != this->Lives)
+        {
+            std::stringstream ss; ss << this->Lives;
+            this->livesText->SetText("Lives:" + ss.str());
+            this->livesShown = this->Lives;
+        }
+        this->text->Draw(*this->livesText);
     }
 
     if (this->State == GAME_MENU)
     {
-        Text->RenderText("Press ENTER to start", 250.0f, Height / 2, 1.0f);
-        Text->RenderText("Press W or S to select level", 245.0f, Height / 2 + 20.0f, 0.75f);
+        for (TextObject* text : this->menuText)
+            this->text->Draw(*text);
     }
     if (this->State == GAME_WIN)
     {
-        Text->RenderText(
-            "You WON!!!", 320.0, Height / 2 - 20.0, 1.0, glm::vec3(0.0, 1.0, 0.0)
-        );
-        Text->RenderText(
-            "Press ENTER to retry or ESC to quit", 130.0, Height / 2, 1.0, glm::vec3(1.0, 1.0, 0.0)
-        );
-    }
-}
-
-Direction VectorDirection(glm::vec2 target)
-{
-    glm::vec2 compass[] = {
-        glm::vec2(0.0f, 1.0f),	// up
-        glm::vec2(1.0f, 0.0f),	// right
-        glm::vec2(0.0f, -1.0f),	// down
-        glm::vec2(-1.0f, 0.0f)	// left
-    };
-    float max = 0.0f;
-    unsigned int best_match = -1;
-    for (unsigned int i = 0; i < 4; i++)
-    {
-        float dot_product = glm::dot(glm::normalize(target), compass[i]);
-        if (dot_product > max)
-        {
-            max = dot_product;
-            best_match = i;
-        }
+        for (TextObject* text : this->winText)
+            this->text->Draw(*text);
     }
-    return (Direction)best_match;
+    this->Rendered.DrawCalls = this->renderer->DrawCalls + this->particles->DrawCalls + this->text->DrawCalls + this->effects->DrawCalls;
+    this->Rendered.Sprites = this->renderer->Sprites;
+    this->Rendered.TextLayouts = this->text->Layouts;
 }
 
 void Game::ResetLevel()
 {
-    if (this->Level == 0)
-        this->Levels[0].Load("C:/cz/BO/BreakOutGame/BreakOutGame/src/levels/one.lvl", this->Width, this->Height / 2);
-    else if (this->Level == 1)
-        this->Levels[1].Load("C:/cz/BO/BreakOutGame/BreakOutGame/src/levels/two.lvl", this->Width, this->Height / 2);
-    else if (this->Level == 2)
-        this->Levels[2].Load("C:/cz/BO/BreakOutGame/BreakOutGame/src/levels/three.lvl", this->Width, this->Height / 2);
-    else if (this->Level == 3)
-        this->Levels[3].Load("C:/cz/BO/BreakOutGame/BreakOutGame/src/levels/four.lvl", this->Width, this->Height / 2);
+    // restores the bricks in place; the level files are only read once in LoadLevels
+    this->Levels[this->Level].Reset();
     this->Lives = 3;
 }
 
 void Game::ResetPlayer()
 {
     // reset player/ball stats
-    Player->Size = PLAYER_SIZE;
-    Player->Position = glm::vec2(this->Width / 2.0f - PLAYER_SIZE.x / 2.0f, this->Height - PLAYER_SIZE.y);
-    Ball->Reset(Player->Position + glm::vec2(PLAYER_SIZE.x / 2.0f - BALL_RADIUS, -(BALL_RADIUS * 2.0f)), INITIAL_BALL_VELOCITY);
-}
-
-Collision CheckCollision(BallObject& one, GameObject& two) // AABB - Circle collision
-{
-    // get center point circle first 
-    glm::vec2 center(one.Position + one.Radius);
-    // calculate AABB info (center, half-extents)
-    glm::vec2 aabb_half_extents(two.Size.x / 2.0f, two.Size.y / 2.0f);
-    glm::vec2 aabb_center(
-        two.Position.x + aabb_half_extents.x,
-        two.Position.y + aabb_half_extents.y
-    );
-    // get difference vector between both centers
-    glm::vec2 difference = center - aabb_center;
-    glm::vec2 clamped = glm::clamp(difference, -aabb_half_extents, aabb_half_extents);
-    // add clamped value to AABB_center and we get the value of box closest to circle
-    glm::vec2 closest = aabb_center + clamped;
-    // retrieve vector between center circle and closest point AABB and check if length <= radius
-    difference = closest - center;
-    if (glm::length(difference) <= one.Radius)
-        return std::make_tuple(true, VectorDirection(difference), difference);
-    else
-        return std::make_tuple(false, UP, glm::vec2(0.0f, 0.0f));
+    this->player->Size = PLAYER_SIZE;
+    this->player->Position = glm::vec2(this->Width / 2.0f - PLAYER_SIZE.x / 2.0f, this->Height - PLAYER_SIZE.y);
+    // back to a single ball stuck to the paddle
+    if (this->Balls.empty())
+        this->Balls.push_back(BallObject(glm::vec2(0.0f), BALL_RADIUS, INITIAL_BALL_VELOCITY, this->ballTexture));
+    this->Balls.resize(1);
+    BallObject& ball = this->Balls.front();
+    ball.Reset(this->player->Position + glm::vec2(PLAYER_SIZE.x / 2.0f - BALL_RADIUS, -(BALL_RADIUS * 2.0f)), INITIAL_BALL_VELOCITY);
+    // teleported, so don't interpolate from the old positions
+    this->player->PrevPosition = this->player->Position;
+    ball.PrevPosition = ball.Position;
 }
 
 bool CheckCollision(GameObject& one, GameObject& two) // AABB - AABB collision
@@ -346,110 +547,136 @@ bool CheckCollision(GameObject& one, GameObject& two) // AABB - AABB collision
 }
 
 
-void ActivatePowerUp(PowerUp& powerUp)
+void Game::ActivatePowerUp(PowerUp& powerUp)
 {
+    // ball power-ups apply to every ball in play at the time they are collected
     if (powerUp.Type == "speed")
     {
-        Ball->Velocity *= 1.2;
+        for (BallObject& ball : this->Balls)
+            ball.Velocity *= 1.2;
     }
     else if (powerUp.Type == "sticky")
     {
-        Ball->Sticky = true;
-        Player->Color = glm::vec3(1.0f, 0.5f, 1.0f);
+        for (BallObject& ball : this->Balls)
+            ball.Sticky = true;
+        this->player->Color = glm::vec3(1.0f, 0.5f, 1.0f);
     }
     else if (powerUp.Type == "pass-through")
     {
-        Ball->PassThrough = true;
-        Ball->Color = glm::vec3(1.0f, 0.5f, 0.5f);
+        for (BallObject& ball : this->Balls)
+        {
+            ball.PassThrough = true;
+            ball.Color = glm::vec3(1.0f, 0.5f, 0.5f);
+        }
     }
     else if (powerUp.Type == "pad-size-increase")
     {
-        Player->Size.x += 50;
+        this->player->Size.x += 50;
     }
     else if (powerUp.Type == "confuse")
     {
-        if (!Effects->Chaos)
-            Effects->Confuse = true; // only activate if chaos wasn't already active
+        if (!this->Chaos)
+            this->Confuse = true; // only activate if chaos wasn't already active
     }
     else if (powerUp.Type == "chaos")
     {
-        if (!Effects->Confuse)
-            Effects->Chaos = true;
+        if (!this->Confuse)
+            this->Chaos = true;
     }
 }
 
 
 
-void Game::DoCollisions()
+void Game::moveBall(BallObject& ball, float dt)
 {
-    for (GameObject& box : this->Levels[this->Level].Bricks)
+    // move the ball hit by hit: sweep it against all bricks and the paddle, advance it to the
+    // earliest contact, resolve that contact and keep going for the rest of the step
+    float remaining = dt;
+    for (unsigned int i = 0; i < MAX_BALL_COLLISIONS && remaining > 0.0f && !ball.Stuck; ++i)
     {
-        if (!box.Destroyed)
+        GameLevel& level = this->Levels[this->Level];
+        glm::vec2 center = ball.Position + ball.Radius;
+        glm::vec2 delta = ball.Velocity * remaining;
+        // broadphase: bricks overlapping a circle that bounds the whole swept ball
+        this->brickCandidates.clear();
+        level.Query(center + delta * 0.5f, ball.Radius + glm::length(delta) * 0.5f, this->brickCandidates);
+        SweepHit hit, earliest;
+        bool hitPlayer = false;
+        int target = -1;
+        for (unsigned int brick : this->brickCandidates)
         {
-            Collision collision = CheckCollision(*Ball, box);
-            if (std::get<0>(collision)) // if collision is true
+            glm::vec2 brickPos = level.BrickPosition(brick);
+            if (SweepCircleAABB(center, ball.Radius, delta, brickPos, brickPos + level.UnitSize, hit)
+                && (target < 0 || hit.Time < earliest.Time))
             {
-                // destroy block if not solid
-                Direction dir = std::get<1>(collision);
-                glm::vec2 diff_vector = std::get<2>(collision);
-                if (!(Ball->PassThrough && !box.IsSolid)) {
-                    box.Destroyed = true;
-                    this->SpawnPowerUps(box);
-                    SoundEngine->play2D("C:/cz/BO/BreakOutGame/BreakOutGame/src/audio/bleep.mp3", false);
-                }
-
-                else {
-                    ShakeTime = 0.05f;
-                    Effects->Shake = true;
-                    SoundEngine->play2D("C:/cz/BO/BreakOutGame/BreakOutGame/src/audio/bleep.mp3", false);
+                earliest = hit;
+                target = brick;
+            }
+        }
+        if (SweepCircleAABB(center, ball.Radius, delta, this->player->Position, this->player->Position + this->player->Size, hit)
+            && (target < 0 || hit.Time < earliest.Time))
+        {
+            earliest = hit;
+            hitPlayer = true;
+        }
+        if (target < 0 && !hitPlayer)
+        {
+            ball.Move(remaining, this->Width);
+            break;
+        }
+        ball.Move(remaining * earliest.Time, this->Width);
+        remaining -= remaining * earliest.Time;
 
-                }
-                // collision resolution
+        if (hitPlayer)
+        {
+            // check where it hit the board, and change velocity based on where it hit the board
+            float centerBoard = this->player->Position.x + this->player->Size.x / 2.0f;
+            float distance = (ball.Position.x + ball.Radius) - centerBoard;
+            float percentage = distance / (this->player->Size.x / 2.0f);
+            // then move accordingly
+            float strength = 2.0f;
+            glm::vec2 oldVelocity = ball.Velocity;
+            ball.Velocity.x = INITIAL_BALL_VELOCITY.x * percentage * strength;
+            ball.Velocity.y = -1.0f * abs(ball.Velocity.y);
+            ball.Velocity = glm::normalize(ball.Velocity) * glm::length(oldVelocity);
+            ball.Stuck = ball.Sticky;
+            this->playAudio("audio/bleep.wav");
+            continue;
+        }
 
-                if (dir == LEFT || dir == RIGHT) // horizontal collision
-                {
-                    Ball->Velocity.x = -Ball->Velocity.x; // reverse horizontal velocity
-                    // relocate
-                    float penetration = Ball->Radius - std::abs(diff_vector.x);
-                    if (dir == LEFT)
-                        Ball->Position.x += penetration; // move ball to right
-                    else
-                        Ball->Position.x -= penetration; // move ball to left;
-                }
-                else // vertical collision
-                {
-                    Ball->Velocity.y = -Ball->Velocity.y; // reverse vertical velocity
-                    // relocate
-                    float penetration = Ball->Radius - std::abs(diff_vector.y);
-                    if (dir == UP)
-                        Ball->Position.y -= penetration; // move ball back up
-                    else
-                        Ball->Position.y += penetration; // move ball back down
-                }
-            }
+        // the game's response rules: a hit destroys the block, solid or not, unless a pass-through
+        // ball hits a non-solid block, which only shakes the screen; the ball bounces off either way
+        bool solid = level.IsSolid(target);
+        if (!(ball.PassThrough && !solid))
+        {
+            level.DestroyBrick(target);
+            ++this->Stats.BricksDestroyed;
+            this->SpawnPowerUps(level.BrickPosition(target));
+            this->playAudio("audio/bleep.mp3");
         }
-        
+        else
+        {
+            this->shakeTime = 0.05f;
+            this->Shake = true;
+            this->playAudio("audio/bleep.mp3");
+        }
+        // collision resolution: reflect along the dominant axis of the contact normal (corners pick the axis we're moving into)
+        glm::vec2 normal = earliest.Normal;
+        bool horizontal = std::abs(normal.x) > std::abs(normal.y);
+        if (horizontal ? ball.Velocity.x * normal.x >= 0.0f : ball.Velocity.y * normal.y >= 0.0f)
+            horizontal = !horizontal;
+        if (horizontal)
+            ball.Velocity.x = -ball.Velocity.x; // reverse horizontal velocity
+        else
+            ball.Velocity.y = -ball.Velocity.y; // reverse vertical velocity
     }
+}
 
-    // player - ball collision
-    Collision result = CheckCollision(*Ball, *Player);
-    if (!Ball->Stuck && std::get<0>(result))
-    {
-        // check where it hit the board, and change velocity based on where it hit the board
-        float centerBoard = Player->Position.x + Player->Size.x / 2.0f;
-        float distance = (Ball->Position.x + Ball->Radius) - centerBoard;
-        float percentage = distance / (Player->Size.x / 2.0f);
-        // then move accordingly
-        float strength = 2.0f;
-        glm::vec2 oldVelocity = Ball->Velocity;
-        Ball->Velocity.x = INITIAL_BALL_VELOCITY.x * percentage * strength;
-        Ball->Velocity.y = -1.0f * abs(Ball->Velocity.y);
-        Ball->Velocity = glm::normalize(Ball->Velocity) * glm::length(oldVelocity);
-        Ball->Stuck = Ball->Sticky;
-        SoundEngine->play2D("C:/cz/BO/BreakOutGame/BreakOutGame/src/audio/bleep.wav", false);
-
-        
-    }
+void Game::DoCollisions(float dt)
+{
+    // all balls in one pass over the contiguous ball array
+    for (BallObject& ball : this->Balls)
+        this->moveBall(ball, dt);
 
     for (PowerUp& powerUp : this->PowerUps)
     {
@@ -457,48 +684,48 @@ void Game::DoCollisions()
         {
             if (powerUp.Position.y >= this->Height)
                 powerUp.Destroyed = true;
-            if (CheckCollision(*Player, powerUp))
+            if (CheckCollision(*this->player, powerUp))
             {	// collided with player, now activate powerup
-                ActivatePowerUp(powerUp);
+                this->ActivatePowerUp(powerUp);
+                ++this->Stats.PowerUpsCollected;
                 powerUp.Destroyed = true;
                 powerUp.Activated = true;
-                SoundEngine->play2D("C:/cz/BO/BreakOutGame/BreakOutGame/src/audio/powerup.wav", false);
+                this->playAudio("audio/powerup.wav");
 
             }
         }
     }
 }
 
-bool ShouldSpawn(unsigned int chance)
+bool ShouldSpawn(Random& random, unsigned int chance)
 {
-    unsigned int random = rand() % chance;
-    return random == 0;
+    return random.OneIn(chance);
 }
-void Game::SpawnPowerUps(GameObject& block)
+void Game::SpawnPowerUps(glm::vec2 position)
 {
-    if (ShouldSpawn(75)) // 1 in 75 chance
+    if (ShouldSpawn(this->spawnRandom, 75)) // 1 in 75 chance
         this->PowerUps.push_back(
-            PowerUp("speed", glm::vec3(0.5f, 0.5f, 1.0f), 0.0f, block.Position, ResourceManager::GetTexture("powerup_speed")
+            PowerUp("speed", glm::vec3(0.5f, 0.5f, 1.0f), 0.0f, position, this->speedTexture
             ));
-    if (ShouldSpawn(75))
+    if (ShouldSpawn(this->spawnRandom, 75))
         this->PowerUps.push_back(
-            PowerUp("sticky", glm::vec3(1.0f, 0.5f, 1.0f), 20.0f, block.Position, ResourceManager::GetTexture("powerup_sticky")
+            PowerUp("sticky", glm::vec3(1.0f, 0.5f, 1.0f), 20.0f, position, this->stickyTexture
             ));
-    if (ShouldSpawn(75))
+    if (ShouldSpawn(this->spawnRandom, 75))
         this->PowerUps.push_back(
-            PowerUp("pass-through", glm::vec3(0.5f, 1.0f, 0.5f), 10.0f, block.Position, ResourceManager::GetTexture("powerup_passthrough")
+            PowerUp("pass-through", glm::vec3(0.5f, 1.0f, 0.5f), 10.0f, position, this->passThroughTexture
             ));
-    if (ShouldSpawn(75))
+    if (ShouldSpawn(this->spawnRandom, 75))
         this->PowerUps.push_back(
-            PowerUp("pad-size-increase", glm::vec3(1.0f, 0.6f, 0.4), 0.0f, block.Position, ResourceManager::GetTexture("powerup_increase")
+            PowerUp("pad-size-increase", glm::vec3(1.0f, 0.6f, 0.4), 0.0f, position, this->increaseTexture
             ));
-    if (ShouldSpawn(15)) // negative powerups should spawn more often
+    if (ShouldSpawn(this->spawnRandom, 15)) // negative powerups should spawn more often
         this->PowerUps.push_back(
-            PowerUp("confuse", glm::vec3(1.0f, 0.3f, 0.3f), 15.0f, block.Position, ResourceManager::GetTexture("powerup_confuse")
+            PowerUp("confuse", glm::vec3(1.0f, 0.3f, 0.3f), 15.0f, position, this->confuseTexture
             ));
-    if (ShouldSpawn(15))
+    if (ShouldSpawn(this->spawnRandom, 15))
         this->PowerUps.push_back(
-            PowerUp("chaos", glm::vec3(0.9f, 0.25f, 0.25f), 15.0f, block.Position, ResourceManager::GetTexture("powerup_chaos")
+            PowerUp("chaos", glm::vec3(0.9f, 0.25f, 0.25f), 15.0f, position, this->chaosTexture
             ));
 }
 
@@ -532,30 +759,34 @@ void Game::UpdatePowerUps(float dt)
                 {
                     if (!isOtherPowerUpActive(this->PowerUps, "sticky"))
                     {	// only reset if no other PowerUp of type sticky is active
-                        Ball->Sticky = false;
-                        Player->Color = glm::vec3(1.0f);
+                        for (BallObject& ball : this->Balls)
+                            ball.Sticky = false;
+                        this->player->Color = glm::vec3(1.0f);
                     }
                 }
                 else if (powerUp.Type == "pass-through")
                 {
                     if (!isOtherPowerUpActive(this->PowerUps, "pass-through"))
                     {	// only reset if no other PowerUp of type pass-through is active
-                        Ball->PassThrough = false;
-                        Ball->Color = glm::vec3(1.0f);
+                        for (BallObject& ball : this->Balls)
+                        {
+                            ball.PassThrough = false;
+                            ball.Color = glm::vec3(1.0f);
+                        }
                     }
                 }
                 else if (powerUp.Type == "confuse")
                 {
                     if (!isOtherPowerUpActive(this->PowerUps, "confuse"))
                     {	// only reset if no other PowerUp of type confuse is active
-                        Effects->Confuse = false;
+                        this->Confuse = false;
                     }
                 }
                 else if (powerUp.Type == "chaos")
                 {
                     if (!isOtherPowerUpActive(this->PowerUps, "chaos"))
                     {	// only reset if no other PowerUp of type chaos is active
-                        Effects->Chaos = false;
+                        this->Chaos = false;
                     }
                 }
             }
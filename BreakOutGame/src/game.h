@@ -13,7 +13,19 @@
 #include <GLFW/glfw3.h>
 
 #include "game_level.h"
+#include "ball_object.h"
 #include "power_up.h"
+#include "post_processor.h"
+#include "random.h"
+
+class SpriteRenderer;
+class SpriteBuffer;
+class ParticleGenerator;
+class TextRenderer;
+class TextObject;
+class FrameUniforms;
+class JobSystem;
+namespace irrklang { class ISoundEngine; }
 
 
 // Represents the current state of the game
@@ -23,27 +35,35 @@ enum GameState {
     GAME_WIN
 };
 
-// Represents the four possible (collision) directions
-enum Direction {
-    UP,
-    RIGHT,
-    DOWN,
-    LEFT
+// Running totals of what happened in a game, for balancing runs
+struct GameStats {
+    unsigned int LivesLost;
+    unsigned int LevelsCompleted;
+    unsigned int BricksDestroyed;
+    unsigned int PowerUpsCollected;
 };
 
-// Defines a Collision typedef that represents collision data
-typedef std::tuple<bool, Direction, glm::vec2> Collision; // <collision?, what direction?, difference vector center - closest point>
+// What the last Render submitted to the GPU
+struct RenderStats {
+    unsigned int DrawCalls;   // every draw call of the frame (sprites, particles, text, post-processing)
+    unsigned int Sprites;     // sprites drawn by the sprite renderer
+    unsigned int TextLayouts; // strings the text renderer had to lay out (zero while the text on screen is unchanged)
+};
 
 // Initial size of the player paddle
 const glm::vec2 PLAYER_SIZE(100.0f, 20.0f);
 // Initial velocity of the player paddle
 const float PLAYER_VELOCITY(500.0f);
+// Highest simulation rate in ticks per second (from --rate or a replay); a tick is then still 100 us
+const unsigned int MAX_SIMULATION_RATE = 10000;
 
 
 
 // Game holds all game-related state and functionality.
 // Combines all game-related data into a single class for
 // easy access to each of the components and manageability.
+// All state is owned by the instance, so any number of games
+// can run side by side (headless ones even on separate threads).
 class Game
 {
 public:
@@ -54,24 +74,86 @@ public:
     unsigned int            Width, Height;
     std::vector<PowerUp> PowerUps;
     std::vector<GameLevel>  Levels;
+    // balls in play, stepped together; never empty, losing the last one costs a life
+    std::vector<BallObject> Balls;
     unsigned int            Level;
     unsigned int Lives;
+    // active screen effects; simulation state, mirrored into the frame uniforms when rendering
+    bool                    Confuse, Chaos, Shake;
+    // when set before Init, no window, GL or audio resources are created and Render must not be called
+    bool                    Headless;
+    // when set before Init, particles are simulated on the GPU with transform feedback
+    bool                    GpuParticles;
+    // anti-aliasing of the scene; set before Init or switch with SetAntiAliasing
+    AntiAliasingMode        AntiAliasing;
+    // counters since construction
+    GameStats               Stats;
+    // draw counts of the last Render
+    RenderStats             Rendered;
     // constructor/destructor
     Game(unsigned int width, unsigned int height);
     ~Game();
-    // initialize game state (load all shaders/textures/levels)
+    // initialize game state (load all shaders/textures/levels); a headless game keeps Levels already set
     void Init();
+    // loads the level files, as jobs when given a job system (the caller then waits for them)
+    void LoadLevels(JobSystem* jobs = nullptr);
     // game loop
+    void Step(float dt); // one fixed simulation tick: stores the render interpolation state, then ProcessInput and Update
     void ProcessInput(float dt);
     void Update(float dt);
-    void Render();
+    void Render(float alpha = 1.0f); // alpha blends moving objects between the last two simulation states
+    void EndFrame(); // drops the per-frame brick change journals once the frame has consumed them
+    void SetAntiAliasing(AntiAliasingMode mode);
 
-    void DoCollisions();
-    void SpawnPowerUps(GameObject& block);
+    void DoCollisions(float dt); // moves every ball through the step, resolving every contact along the way
+    void SpawnPowerUps(glm::vec2 position); // rolls for power-ups dropping from a brick destroyed at position
     void UpdatePowerUps(float dt);
+    void ActivatePowerUp(PowerUp& powerUp);
+    // restarts every random stream of the game from the given seed
+    void Seed(uint64_t seed);
+    // hash of the whole simulation state, for replay verification
+    uint32_t Checksum() const;
+    // simulation objects
+    BallObject& GetBall(); // the first ball in play; only valid after Init
+    void SpawnBall(glm::vec2 position, glm::vec2 velocity); // adds a released ball
+    GameObject& GetPlayer();
     // reset
     void ResetLevel();
     void ResetPlayer();
+private:
+    // render state (null when headless) and the paddle
+    SpriteRenderer*         renderer;
+    GameObject*             player;
+    PostProcessor*          effects;
+    ParticleGenerator*      particles;
+    TextRenderer*           text;
+    FrameUniforms*          frameUniforms;
+    // bricks of the level being shown, kept on the GPU, and which level that is
+    SpriteBuffer*           levelSprites;
+    unsigned int            levelSpritesLevel;
+    // retained strings: the HUD, the menu and win screens, and the lives count the HUD was last set to
+    TextObject*             livesText;
+    TextObject*             menuText[2];
+    TextObject*             winText[2];
+    unsigned int            livesShown;
+    // textures, looked up by name once in initSimulation (null handles when headless)
+    TextureHandle           backgroundTexture, ballTexture;
+    TextureHandle           speedTexture, stickyTexture, passThroughTexture, increaseTexture, confuseTexture, chaosTexture;
+    irrklang::ISoundEngine* soundEngine;
+    // remaining duration of the screen shake
+    float                   shakeTime;
+    // seed of the random streams; gameplay rolls (power-up drops) have their own stream,
+    // the particle generator owns the cosmetic one
+    uint64_t                seed;
+    Random                  spawnRandom;
+    // scratch list for broadphase queries
+    std::vector<unsigned int> brickCandidates;
+    // sweeps one ball through the step
+    void moveBall(BallObject& ball, float dt);
+    // creates the player and ball; needs no GL context
+    void initSimulation();
+    // plays a sound effect; a no-op when running without an audio device
+    void playAudio(const char* file, bool looped = false);
 
 };
 
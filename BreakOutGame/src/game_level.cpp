@@ -7,23 +7,57 @@
 ** option) any later version.
 ******************************************************************/
 #include "game_level.h"
+#include "collision.h"
+#include "file_system.h"
 
-#include <fstream>
+#include <algorithm>
+#include <cmath>
 #include <sstream>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 
+// color of a brick by its tile code
+static glm::vec3 brickColor(unsigned int type)
+{
+    if (type == 1) // solid
+        return glm::vec3(0.8f, 0.8f, 0.7f);
+    if (type == 2)
+        return glm::vec3(0.2f, 0.6f, 1.0f);
+    if (type == 3)
+        return glm::vec3(0.0f, 0.7f, 0.0f);
+    if (type == 4)
+        return glm::vec3(0.8f, 0.8f, 0.4f);
+    if (type == 5)
+        return glm::vec3(1.0f, 0.5f, 0.0f);
+    return glm::vec3(1.0f); // original: white
+}
+
+// index of the lowest set bit; word must be non-zero
+static unsigned int lowestBit(uint32_t word)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, word);
+    return index;
+#else
+    return __builtin_ctz(word);
+#endif
+}
+
 void GameLevel::Load(const char* file, unsigned int levelWidth, unsigned int levelHeight)
 {
     // clear old data
-    this->Bricks.clear();
+    this->clear();
     // load from file
     unsigned int tileCode;
     GameLevel level;
-    std::string line;
-    std::ifstream fstream(file);
+    std::string line, text;
     std::vector<std::vector<unsigned int>> tileData;
-    if (fstream)
+    if (FileSystem::ReadText(file, text))
     {
+        std::istringstream fstream(text);
         while (std::getline(fstream, line)) // read each line from level file
         {
             std::istringstream sstream(line);
@@ -37,57 +71,147 @@ void GameLevel::Load(const char* file, unsigned int levelWidth, unsigned int lev
     }
 }
 
+void GameLevel::LoadTiles(const std::vector<std::vector<unsigned int>>& tileData, unsigned int levelWidth, unsigned int levelHeight)
+{
+    this->clear();
+    if (tileData.size() > 0)
+        this->init(tileData, levelWidth, levelHeight);
+}
+
+void GameLevel::Build(SpriteBuffer& sprites) const
+{
+    const Texture2D& block = ResourceManager::GetTexture("block");
+    const Texture2D& blockSolid = ResourceManager::GetTexture("block_solid");
+    // sprite index == slot, so a journal entry maps straight to the sprite to patch
+    sprites.Clear();
+    for (unsigned int slot = 0; slot < this->SlotCount(); ++slot)
+        sprites.Add(this->IsSolid(slot) ? blockSolid : block, this->BrickPosition(slot), this->UnitSize, 0.0f, brickColor(this->BrickType[slot]), !this->IsDestroyed(slot));
+}
+
+void GameLevel::Sync(SpriteBuffer& sprites) const
+{
+    for (unsigned int slot : this->changes)
+        sprites.SetVisible(slot, !this->IsDestroyed(slot));
+}
+
 void GameLevel::Draw(SpriteRenderer& renderer)
 {
-    for (GameObject& tile : this->Bricks)
-        if (!tile.Destroyed)
-            tile.Draw(renderer);
+    const Texture2D& block = ResourceManager::GetTexture("block");
+    const Texture2D& blockSolid = ResourceManager::GetTexture("block_solid");
+    // walk the set bits of the inverted mask so fully destroyed words are skipped at once
+    for (unsigned int word = 0; word < this->DestroyedMask.size(); ++word)
+    {
+        uint32_t alive = ~this->DestroyedMask[word];
+        while (alive)
+        {
+            unsigned int slot = word * 32 + lowestBit(alive);
+            alive &= alive - 1;
+            if (slot >= this->SlotCount())
+                break;
+            renderer.Submit(this->IsSolid(slot) ? blockSolid : block, this->BrickPosition(slot), this->UnitSize, 0.0f, brickColor(this->BrickType[slot]));
+        }
+    }
+}
+
+void GameLevel::Reset()
+{
+    // journal every slot that differs from the loaded state, then restore it in bulk
+    for (unsigned int word = 0; word < this->DestroyedMask.size(); ++word)
+    {
+        uint32_t changed = this->DestroyedMask[word] ^ this->initialMask[word];
+        while (changed)
+        {
+            this->changes.push_back(word * 32 + lowestBit(changed));
+            changed &= changed - 1;
+        }
+    }
+    this->DestroyedMask = this->initialMask;
+    this->remaining = this->initialRemaining;
 }
 
-bool GameLevel::IsCompleted()
+void GameLevel::Query(glm::vec2 center, float radius, std::vector<unsigned int>& bricks) const
 {
-    for (GameObject& tile : this->Bricks)
-        if (!tile.IsSolid && !tile.Destroyed)
-            return false;
-    return true;
+    if (this->SlotCount() == 0 || center.x + radius < 0.0f || center.y + radius < 0.0f)
+        return;
+    // convert the circle's bounds to an (inclusive) range of cells, clamped to the grid
+    int x0 = static_cast<int>(std::floor((center.x - radius) / this->UnitSize.x));
+    int y0 = static_cast<int>(std::floor((center.y - radius) / this->UnitSize.y));
+    int x1 = static_cast<int>(std::floor((center.x + radius) / this->UnitSize.x));
+    int y1 = static_cast<int>(std::floor((center.y + radius) / this->UnitSize.y));
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, static_cast<int>(this->GridWidth) - 1);
+    y1 = std::min(y1, static_cast<int>(this->GridHeight) - 1);
+    if (x0 > x1 || y0 > y1)
+        return;
+    // each row of cells is a contiguous run of slots for the SIMD kernel
+    unsigned int count = x1 - x0 + 1;
+    for (int y = y0; y <= y1; ++y)
+    {
+        size_t offset = bricks.size();
+        bricks.resize(offset + count);
+        unsigned int hits = OverlapCircleBricks(this->BrickX.data(), this->BrickY.data(), this->DestroyedMask.data(),
+            y * this->GridWidth + x0, count, this->UnitSize, center, radius, &bricks[offset]);
+        bricks.resize(offset + hits);
+    }
 }
 
-void GameLevel::init(std::vector<std::vector<unsigned int>> tileData, unsigned int levelWidth, unsigned int levelHeight)
+void GameLevel::DestroyBrick(unsigned int slot)
+{
+    if (this->IsDestroyed(slot))
+        return;
+    this->DestroyedMask[slot >> 5] |= 1u << (slot & 31);
+    if (!this->IsSolid(slot))
+        --this->remaining;
+    this->changes.push_back(slot);
+}
+
+void GameLevel::clear()
+{
+    this->GridWidth = this->GridHeight = 0;
+    this->BrickX.clear();
+    this->BrickY.clear();
+    this->BrickType.clear();
+    this->DestroyedMask.clear();
+    this->initialMask.clear();
+    this->remaining = this->initialRemaining = 0;
+    this->changes.clear();
+}
+
+void GameLevel::init(const std::vector<std::vector<unsigned int>>& tileData, unsigned int levelWidth, unsigned int levelHeight)
 {
     // calculate dimensions
     unsigned int height = tileData.size();
     unsigned int width = tileData[0].size(); // note we can index vector at [0] since this function is only called if height > 0
     float unit_width = levelWidth / static_cast<float>(width), unit_height = levelHeight / height;
+    this->GridWidth = width;
+    this->GridHeight = height;
+    this->UnitSize = glm::vec2(unit_width, unit_height);
+    // every slot starts out empty (destroyed) until a brick is placed in it
+    unsigned int slots = width * height;
+    this->BrickX.resize(slots);
+    this->BrickY.resize(slots);
+    this->BrickType.assign(slots, 0);
+    this->DestroyedMask.assign((slots + 31) / 32, ~0u);
     // initialize level tiles based on tileData		
     for (unsigned int y = 0; y < height; ++y)
     {
         for (unsigned int x = 0; x < width; ++x)
         {
-            // check block type from level data (2D level array)
-            if (tileData[y][x] == 1) // solid
+            unsigned int slot = y * width + x;
+            this->BrickX[slot] = unit_width * x;
+            this->BrickY[slot] = unit_height * y;
+            // check block type from level data (2D level array); 1 is solid, anything higher is colored
+            unsigned int type = x < tileData[y].size() ? tileData[y][x] : 0;
+            if (type > 0)
             {
-                glm::vec2 pos(unit_width * x, unit_height * y);
-                glm::vec2 size(unit_width, unit_height);
-                GameObject obj(pos, size, ResourceManager::GetTexture("block_solid"), glm::vec3(0.8f, 0.8f, 0.7f));
-                obj.IsSolid = true;
-                this->Bricks.push_back(obj);
-            }
-            else if (tileData[y][x] > 1)	// non-solid; now determine its color based on level data
-            {
-                glm::vec3 color = glm::vec3(1.0f); // original: white
-                if (tileData[y][x] == 2)
-                    color = glm::vec3(0.2f, 0.6f, 1.0f);
-                else if (tileData[y][x] == 3)
-                    color = glm::vec3(0.0f, 0.7f, 0.0f);
-                else if (tileData[y][x] == 4)
-                    color = glm::vec3(0.8f, 0.8f, 0.4f);
-                else if (tileData[y][x] == 5)
-                    color = glm::vec3(1.0f, 0.5f, 0.0f);
-
-                glm::vec2 pos(unit_width * x, unit_height * y);
-                glm::vec2 size(unit_width, unit_height);
-                this->Bricks.push_back(GameObject(pos, size, ResourceManager::GetTexture("block"), color));
+                this->BrickType[slot] = static_cast<unsigned char>(std::min(type, 255u));
+                this->DestroyedMask[slot >> 5] &= ~(1u << (slot & 31));
+                if (type > 1)
+                    ++this->initialRemaining;
             }
         }
     }
-}
\ No newline at end of file
+    this->initialMask = this->DestroyedMask;
+    this->remaining = this->initialRemaining;
+}
@@ -8,6 +8,7 @@
 ******************************************************************/
 #ifndef GAMELEVEL_H
 #define GAMELEVEL_H
+#include <cstdint>
 #include <vector>
 
 #include <glad/glad.h>
@@ -20,22 +21,63 @@
 
 /// GameLevel holds all Tiles as part of a Breakout level and 
 /// hosts functionality to Load/render levels from the harddisk.
+/// Bricks are stored as structure-of-arrays with one slot per
+/// tile in row-major order, so the tile grid doubles as the
+/// collision broadphase and a row of cells is a contiguous range.
+/// Destruction is tracked incrementally: a live count of the
+/// remaining destructible bricks and a journal of the slots that
+/// changed since the last ClearChanges, for consumers that only
+/// want the deltas.
 class GameLevel
 {
 public:
-    // level state
-    std::vector<GameObject> Bricks;
+    // level layout: GridWidth x GridHeight slots, every brick is UnitSize large
+    unsigned int               GridWidth, GridHeight;
+    glm::vec2                  UnitSize;
+    // brick state, indexed by slot (y * GridWidth + x)
+    std::vector<float>         BrickX, BrickY;   // top-left corner
+    std::vector<unsigned char> BrickType;        // tile code: 0 = empty, 1 = solid, 2..5 = colored
+    std::vector<uint32_t>      DestroyedMask;    // one bit per slot; empty slots are always set. Change through DestroyBrick/Reset only
     // constructor
-    GameLevel() { }
+    GameLevel() : GridWidth(0), GridHeight(0), UnitSize(0.0f), remaining(0), initialRemaining(0) { }
     // loads level from file
     void Load(const char* file, unsigned int levelWidth, unsigned int levelHeight);
+    // loads level from tile data in the same layout as a level file (rows of tile codes)
+    void LoadTiles(const std::vector<std::vector<unsigned int>>& tileData, unsigned int levelWidth, unsigned int levelHeight);
     // render level
     void Draw(SpriteRenderer& renderer);
+    // fills a sprite buffer with one sprite per slot, hidden unless the brick is alive (upload it afterwards)
+    void Build(SpriteBuffer& sprites) const;
+    // updates the visibility of the slots in the change journal in a buffer filled by Build
+    void Sync(SpriteBuffer& sprites) const;
     // check if the level is completed (all non-solid tiles are destroyed)
-    bool IsCompleted();
+    bool IsCompleted() const { return this->remaining == 0; }
+    // restores every brick to the state it was loaded in
+    void Reset();
+    // appends the slots of all live bricks overlapping the circle (center, radius)
+    void Query(glm::vec2 center, float radius, std::vector<unsigned int>& bricks) const;
+    // brick accessors
+    unsigned int SlotCount() const { return GridWidth * GridHeight; }
+    bool         IsDestroyed(unsigned int slot) const { return (DestroyedMask[slot >> 5] >> (slot & 31)) & 1u; }
+    bool         IsSolid(unsigned int slot) const { return BrickType[slot] == 1; }
+    glm::vec2    BrickPosition(unsigned int slot) const { return glm::vec2(BrickX[slot], BrickY[slot]); }
+    unsigned int RemainingBricks() const { return this->remaining; }
+    // marks a brick destroyed
+    void DestroyBrick(unsigned int slot);
+    // slots whose destroyed state changed since the last ClearChanges, in order of change
+    const std::vector<unsigned int>& Changes() const { return this->changes; }
+    void ClearChanges() { this->changes.clear(); }
 private:
+    // destroyed mask as loaded, restored by Reset
+    std::vector<uint32_t>     initialMask;
+    // destructible bricks still alive, and how many there were after loading
+    unsigned int              remaining, initialRemaining;
+    // change journal
+    std::vector<unsigned int> changes;
+    // removes all bricks
+    void clear();
     // initialize level from tile data
-    void init(std::vector<std::vector<unsigned int>> tileData, unsigned int levelWidth, unsigned int levelHeight);
+    void init(const std::vector<std::vector<unsigned int>>& tileData, unsigned int levelWidth, unsigned int levelHeight);
 };
 
 #endif
\ No newline at end of file
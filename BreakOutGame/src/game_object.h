@@ -12,7 +12,7 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
-#include "texture.h"
+#include "resource_handle.h"
 #include "sprite_renderer.h"
 
 
@@ -24,17 +24,18 @@ class GameObject
 public:
     // object state
     glm::vec2   Position, Size, Velocity;
+    glm::vec2   PrevPosition; // position at the start of the last simulation step, used for render interpolation
     glm::vec3   Color;
     float       Rotation;
     bool        IsSolid;
     bool        Destroyed;
     // render state
-    Texture2D   Sprite;
+    TextureHandle Sprite;
     // constructor(s)
     GameObject();
-    GameObject(glm::vec2 pos, glm::vec2 size, Texture2D sprite, glm::vec3 color = glm::vec3(1.0f), glm::vec2 velocity = glm::vec2(0.0f, 0.0f));
-    // draw sprite
-    virtual void Draw(SpriteRenderer& renderer);
+    GameObject(glm::vec2 pos, glm::vec2 size, TextureHandle sprite, glm::vec3 color = glm::vec3(1.0f), glm::vec2 velocity = glm::vec2(0.0f, 0.0f));
+    // draw sprite, interpolated between the previous and current position by alpha [0,1]
+    virtual void Draw(SpriteRenderer& renderer, float alpha = 1.0f);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,84 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include "headless_runner.h"
+
+#include <chrono>
+
+
+HeadlessRunner::HeadlessRunner(Game& game, float dt, ReplayRecorder* recorder)
+    : game(game), dt(dt), recorder(recorder)
+{
+
+}
+
+void HeadlessRunner::Step()
+{
+    this->autopilot();
+    if (this->recorder)
+        this->recorder->Step(this->dt);
+    else
+        this->game.Step(this->dt);
+    // every tick is a frame without a renderer consuming the change journal
+    this->game.EndFrame();
+}
+
+HeadlessStats HeadlessRunner::Run(unsigned int ticks)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < ticks; ++i)
+        this->Step();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    HeadlessStats stats;
+    stats.Ticks = ticks;
+    stats.Seconds = elapsed.count();
+    stats.TicksPerSecond = stats.Seconds > 0.0 ? ticks / stats.Seconds : 0.0;
+    return stats;
+}
+
+void HeadlessRunner::autopilot()
+{
+    const int keys[] = { GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_SPACE, GLFW_KEY_ENTER };
+    // release everything pressed last tick (mirrors what key_callback does on GLFW_RELEASE)
+    for (int key : keys)
+    {
+        this->game.Keys[key] = false;
+        this->game.KeysProcessed[key] = false;
+    }
+    if (this->game.State != GAME_ACTIVE)
+    {
+        // leave the menu/win screen on the currently selected level
+        this->game.Keys[GLFW_KEY_ENTER] = true;
+        return;
+    }
+    const GameObject& player = this->game.GetPlayer();
+    // follow the ball closest to the bottom edge, preferring balls that are falling
+    const BallObject* lowest = nullptr;
+    for (const BallObject& ball : this->game.Balls)
+    {
+        if (ball.Stuck)
+        {
+            this->game.Keys[GLFW_KEY_SPACE] = true;
+            return;
+        }
+        bool falling = ball.Velocity.y > 0.0f;
+        if (!lowest || (falling && lowest->Velocity.y <= 0.0f)
+            || (falling == (lowest->Velocity.y > 0.0f) && ball.Position.y > lowest->Position.y))
+            lowest = &ball;
+    }
+    const BallObject& ball = *lowest;
+    // keep the paddle under the ball, with a small dead zone so the paddle doesn't jitter
+    float ballCenter = ball.Position.x + ball.Radius;
+    float playerCenter = player.Position.x + player.Size.x / 2.0f;
+    float deadZone = player.Size.x / 8.0f;
+    if (ballCenter < playerCenter - deadZone)
+        this->game.Keys[GLFW_KEY_A] = true;
+    else if (ballCenter > playerCenter + deadZone)
+        this->game.Keys[GLFW_KEY_D] = true;
+}
@@ -0,0 +1,46 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef HEADLESS_RUNNER_H
+#define HEADLESS_RUNNER_H
+
+#include "game.h"
+#include "replay.h"
+
+
+// Results of a headless run
+struct HeadlessStats {
+    unsigned int Ticks;          // number of simulation ticks stepped
+    double       Seconds;        // wall-clock time spent stepping
+    double       TicksPerSecond; // raw simulation throughput
+};
+
+
+// HeadlessRunner steps a Game that was initialized with Headless set
+// as fast as the CPU allows. A simple autopilot stands in for the
+// player: it launches the ball, follows it with the paddle and leaves
+// the menu/win screens right away so the simulation never idles.
+class HeadlessRunner
+{
+public:
+    // constructor (the game must already be initialized); ticks go through recorder when one is given
+    HeadlessRunner(Game& game, float dt, ReplayRecorder* recorder = nullptr);
+    // advances the game by a single tick
+    void Step();
+    // advances the game by the given number of ticks and reports the throughput
+    HeadlessStats Run(unsigned int ticks);
+private:
+    // state
+    Game&           game;
+    float           dt;
+    ReplayRecorder* recorder;
+    // presses the keys a player would press this tick
+    void autopilot();
+};
+
+#endif
@@ -0,0 +1,144 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include "job_system.h"
+
+#include <algorithm>
+#include <cassert>
+
+
+// the job system the current thread is a worker of and the queue it owns there; worker threads set them on
+// startup, every other thread (and a worker using another job system) uses queue 0
+static thread_local const JobSystem* currentOwner = nullptr;
+static thread_local unsigned int currentQueue = 0;
+// the job system whose job the current thread is running, if any
+static thread_local const JobSystem* currentJob = nullptr;
+
+JobSystem::JobSystem(unsigned int threads)
+    : queued(0), pending(0), nextQueue(0), stopping(false)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int i = 0; i < threads; ++i)
+        this->queues.push_back(std::unique_ptr<Queue>(new Queue()));
+    // the thread calling Wait works too, so one thread fewer is started
+    for (unsigned int i = 1; i < threads; ++i)
+        this->workers.push_back(std::thread(&JobSystem::workerLoop, this, i));
+}
+
+JobSystem::~JobSystem()
+{
+    this->Wait();
+    {
+        std::lock_guard<std::mutex> lock(this->sleepLock);
+        this->stopping = true;
+    }
+    this->wake.notify_all();
+    for (std::thread& worker : this->workers)
+        worker.join();
+}
+
+void JobSystem::Submit(Job job)
+{
+    // jobs submitted from a worker stay on its own queue; everything else is spread round-robin
+    unsigned int target = this->ownQueue();
+    if (target == 0)
+        target = this->nextQueue++ % this->queues.size();
+    this->pending++;
+    {
+        // counted under the queue lock, like the pop in runOne, so queued never drops below the jobs really queued
+        std::lock_guard<std::mutex> lock(this->queues[target]->Lock);
+        this->queues[target]->Jobs.push_back(std::move(job));
+        this->queued++;
+    }
+    {
+        // a thread about to sleep checks queued under the sleep lock; taking it here means it either saw the job or gets the notify
+        std::lock_guard<std::mutex> lock(this->sleepLock);
+    }
+    this->wake.notify_one();
+    // a thread in Wait helps with new jobs too (e.g. ones submitted by a running job)
+    this->done.notify_all();
+}
+
+void JobSystem::Wait()
+{
+    // pending counts the calling job itself, so this would never return
+    assert(currentJob != this && "JobSystem::Wait called from one of its own jobs");
+    while (this->pending > 0)
+    {
+        if (this->runOne(this->ownQueue()))
+            continue;
+        // everything left is running on other threads
+        std::unique_lock<std::mutex> lock(this->sleepLock);
+        this->done.wait(lock, [this]() { return this->pending == 0 || this->queued > 0; });
+    }
+}
+
+unsigned int JobSystem::ownQueue() const
+{
+    return currentOwner == this ? currentQueue : 0;
+}
+
+void JobSystem::ParallelFor(unsigned int count, const std::function<void(unsigned int)>& body)
+{
+    for (unsigned int i = 0; i < count; ++i)
+        this->Submit([&body, i]() { body(i); });
+    this->Wait();
+}
+
+bool JobSystem::runOne(unsigned int home)
+{
+    Job job;
+    unsigned int count = static_cast<unsigned int>(this->queues.size());
+    for (unsigned int i = 0; i < count && !job; ++i)
+    {
+        Queue& queue = *this->queues[(home + i) % count];
+        std::lock_guard<std::mutex> lock(queue.Lock);
+        if (queue.Jobs.empty())
+            continue;
+        // newest job from our own queue (still warm in cache), oldest one when stealing
+        if (i == 0)
+        {
+            job = std::move(queue.Jobs.back());
+            queue.Jobs.pop_back();
+        }
+        else
+        {
+            job = std::move(queue.Jobs.front());
+            queue.Jobs.pop_front();
+        }
+        this->queued--;
+    }
+    if (!job)
+        return false;
+    const JobSystem* outerJob = currentJob;
+    currentJob = this;
+    job();
+    currentJob = outerJob;
+    if (--this->pending == 0)
+    {
+        std::lock_guard<std::mutex> lock(this->sleepLock);
+        this->done.notify_all();
+    }
+    return true;
+}
+
+void JobSystem::workerLoop(unsigned int index)
+{
+    currentOwner = this;
+    currentQueue = index;
+    for (;;)
+    {
+        if (this->runOne(index))
+            continue;
+        std::unique_lock<std::mutex> lock(this->sleepLock);
+        this->wake.wait(lock, [this]() { return this->stopping || this->queued > 0; });
+        if (this->stopping && this->queued == 0)
+            return;
+    }
+}
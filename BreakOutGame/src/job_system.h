@@ -0,0 +1,68 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// JobSystem runs jobs on a fixed pool of threads with work stealing.
+// Every thread owns a queue: it takes its own jobs from the back
+// and, once that runs dry, steals from the front of the other
+// queues, so jobs of uneven length still keep every core busy.
+// The thread that calls Wait counts as one of the pool's threads
+// and helps out until all submitted jobs have finished. Jobs may
+// submit further jobs, but must not Wait on their own job system:
+// Wait counts the waiting job as unfinished and would never return.
+class JobSystem
+{
+public:
+    typedef std::function<void()> Job;
+    // constructor/destructor (threads == 0 uses one thread per hardware thread)
+    JobSystem(unsigned int threads = 0);
+    ~JobSystem();
+    // number of threads working on jobs, including the one calling Wait
+    unsigned int ThreadCount() const { return static_cast<unsigned int>(this->queues.size()); }
+    // queues a job; jobs may submit further jobs
+    void Submit(Job job);
+    // runs jobs on the calling thread until every submitted job has finished; not from one of this system's jobs
+    void Wait();
+    // runs body(i) for every i in [0, count) and waits for all of them (so not from a job either)
+    void ParallelFor(unsigned int count, const std::function<void(unsigned int)>& body);
+private:
+    // a thread's job queue
+    struct Queue {
+        std::mutex      Lock;
+        std::deque<Job> Jobs;
+    };
+    // state
+    std::vector<std::unique_ptr<Queue>> queues;  // [0] belongs to the thread calling Wait
+    std::vector<std::thread>            workers;
+    std::atomic<unsigned int>           queued;  // jobs waiting in any queue
+    std::atomic<unsigned int>           pending; // jobs submitted but not yet finished
+    std::atomic<unsigned int>           nextQueue;
+    std::mutex                          sleepLock;
+    std::condition_variable             wake, done;
+    bool                                stopping;
+    // the calling thread's queue: its own if it is one of this system's workers, else queue 0
+    unsigned int ownQueue() const;
+    // takes a job from queue home, or steals one from another queue, and runs it; false if there was none
+    bool runOne(unsigned int home);
+    // worker thread body
+    void workerLoop(unsigned int index);
+};
+
+#endif
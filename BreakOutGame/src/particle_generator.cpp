@@ -8,20 +8,94 @@
 ******************************************************************/
 #include "particle_generator.h"
 
+#include <algorithm>
+#include <cstddef>
+
+
+// the GPU buffers hold Particles as they are laid out in memory
+static_assert(offsetof(Particle, Velocity) == 8 && offsetof(Particle, Color) == 16 && offsetof(Particle, Life) == 32 && sizeof(Particle) == 36,
+    "Particle must match the vertex layout of the GPU particle buffers");
+
 ParticleGenerator::ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount)
-    : shader(shader), texture(texture), amount(amount)
+    : DrawCalls(0), amount(amount), lastUsedParticle(0), shader(shader), texture(texture), gpu(false)
+{
+    this->initRenderData();
+    this->init();
+}
+
+ParticleGenerator::ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount, Shader updateShader)
+    : DrawCalls(0), amount(amount), lastUsedParticle(0), shader(shader), texture(texture), gpu(true), updateShader(updateShader),
+      dtUniform(updateShader.GetUniform<float>("dt")), current(0), nextSlot(0), emittedStart(0)
+{
+    this->initRenderData();
+    this->initGpuData();
+}
+
+ParticleGenerator::ParticleGenerator(unsigned int amount)
+    : DrawCalls(0), amount(amount), lastUsedParticle(0), shader(), texture(), VAO(0), quadVBO(0), instanceVBO(0), gpu(false)
 {
     this->init();
 }
 
-void ParticleGenerator::Update(float dt, GameObject& object, unsigned int newParticles, glm::vec2 offset)
+ParticleGenerator::~ParticleGenerator()
+{
+    if (this->VAO == 0)
+        return;
+    glDeleteVertexArrays(1, &this->VAO);
+    glDeleteBuffers(1, &this->quadVBO);
+    glDeleteBuffers(1, &this->instanceVBO);
+    if (this->gpu)
+    {
+        glDeleteVertexArrays(2, this->updateVAO);
+        glDeleteVertexArrays(2, this->drawVAO);
+        glDeleteBuffers(2, this->stateVBO);
+    }
+}
+
+void ParticleGenerator::Emit(GameObject& object, unsigned int newParticles, glm::vec2 offset)
 {
+    if (this->gpu)
+    {
+        // queue them for the next upload, one slot after the other
+        for (unsigned int i = 0; i < newParticles; ++i)
+        {
+            if (this->emitted.empty())
+                this->emittedStart = this->nextSlot;
+            Particle particle;
+            this->respawnParticle(particle, object, offset);
+            this->emitted.push_back(particle);
+            this->nextSlot = (this->nextSlot + 1) % this->amount;
+        }
+        return;
+    }
     // add new particles 
     for (unsigned int i = 0; i < newParticles; ++i)
     {
         int unusedParticle = this->firstUnusedParticle();
         this->respawnParticle(this->particles[unusedParticle], object, offset);
     }
+}
+
+void ParticleGenerator::Update(float dt)
+{
+    if (this->gpu)
+    {
+        // run particle_update.vs over every particle of the latest buffer, capturing the results into the other one
+        this->uploadEmitted();
+        glEnable(GL_RASTERIZER_DISCARD);
+        this->updateShader.Use();
+        this->dtUniform.Set(dt);
+        glBindVertexArray(this->updateVAO[this->current]);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, this->stateVBO[1 - this->current]);
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, this->amount);
+        glEndTransformFeedback();
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+        glBindVertexArray(0);
+        glDisable(GL_RASTERIZER_DISCARD);
+        this->current = 1 - this->current;
+        return;
+    }
     // update all particles
     for (unsigned int i = 0; i < this->amount; ++i)
     {
@@ -38,29 +112,75 @@ void ParticleGenerator::Update(float dt, GameObject& object, unsigned int newPar
 // render all particles
 void ParticleGenerator::Draw()
 {
-    // use additive blending to give it a 'glow' effect
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-    this->shader.Use();
-    for (Particle particle : this->particles)
+    if (this->gpu)
+    {
+        // every slot is drawn; particle.vs drops the dead ones
+        this->uploadEmitted();
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+        this->shader.Use();
+        glActiveTexture(GL_TEXTURE0);
+        this->texture.Bind();
+        glBindVertexArray(this->drawVAO[this->current]);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, this->amount);
+        glBindVertexArray(0);
+        ++this->DrawCalls;
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        return;
+    }
+    // pack the live particles, in order, so they draw exactly as they would one by one
+    this->instances.clear();
+    for (const Particle& particle : this->particles)
     {
         if (particle.Life > 0.0f)
         {
-            this->shader.SetVector2f("offset", particle.Position);
-            this->shader.SetVector4f("color", particle.Color);
-            this->texture.Bind();
-            glBindVertexArray(this->VAO);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
-            glBindVertexArray(0);
+            ParticleInstance instance;
+            instance.Offset = particle.Position;
+            instance.Color = particle.Color;
+            this->instances.push_back(instance);
         }
     }
+    if (this->instances.empty())
+        return;
+    // orphan last frame's contents so the upload doesn't wait for the previous draw
+    glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, this->amount * sizeof(ParticleInstance), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, this->instances.size() * sizeof(ParticleInstance), this->instances.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // use additive blending to give it a 'glow' effect
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    this->shader.Use();
+    glActiveTexture(GL_TEXTURE0);
+    this->texture.Bind();
+    glVertexAttrib1f(3, 1.0f); // life: everything packed is alive
+    glBindVertexArray(this->VAO);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, static_cast<GLsizei>(this->instances.size()));
+    glBindVertexArray(0);
+    ++this->DrawCalls;
     // don't forget to reset to default blending mode
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
-void ParticleGenerator::init()
+void ParticleGenerator::Seed(uint64_t seed)
+{
+    this->random.Seed(seed, "particles");
+}
+
+std::vector<Particle> ParticleGenerator::Snapshot()
+{
+    if (!this->gpu)
+        return this->particles;
+    this->uploadEmitted();
+    std::vector<Particle> state(this->amount);
+    glBindBuffer(GL_ARRAY_BUFFER, this->stateVBO[this->current]);
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, this->amount * sizeof(Particle), state.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return state;
+}
+
+void ParticleGenerator::initRenderData()
 {
     // set up mesh and attribute properties
-    unsigned int VBO;
     float particle_quad[] = {
         0.0f, 1.0f, 0.0f, 1.0f,
         1.0f, 0.0f, 1.0f, 0.0f,
@@ -71,48 +191,121 @@ void ParticleGenerator::init()
         1.0f, 0.0f, 1.0f, 0.0f
     };
     glGenVertexArrays(1, &this->VAO);
-    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &this->quadVBO);
+    glGenBuffers(1, &this->instanceVBO);
     glBindVertexArray(this->VAO);
     // fill mesh buffer
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->quadVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(particle_quad), particle_quad, GL_STATIC_DRAW);
     // set mesh attributes
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    // per-particle attributes advance once per instance
+    glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, this->amount * sizeof(ParticleInstance), nullptr, GL_STREAM_DRAW);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)offsetof(ParticleInstance, Offset));
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)offsetof(ParticleInstance, Color));
+    glVertexAttribDivisor(2, 1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
+}
+
+void ParticleGenerator::initGpuData()
+{
+    std::vector<Particle> dead(this->amount);
+    glGenBuffers(2, this->stateVBO);
+    glGenVertexArrays(2, this->updateVAO);
+    glGenVertexArrays(2, this->drawVAO);
+    for (unsigned int i = 0; i < 2; ++i)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, this->stateVBO[i]);
+        glBufferData(GL_ARRAY_BUFFER, this->amount * sizeof(Particle), dead.data(), GL_DYNAMIC_COPY);
+        // the update reads whole particles, one vertex each
+        glBindVertexArray(this->updateVAO[i]);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, Position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, Velocity));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, Color));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, Life));
+        // drawing uses the quad plus position, color and life per instance
+        glBindVertexArray(this->drawVAO[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, this->quadVBO);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+        glBindBuffer(GL_ARRAY_BUFFER, this->stateVBO[i]);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, Position));
+        glVertexAttribDivisor(1, 1);
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, Color));
+        glVertexAttribDivisor(2, 1);
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, Life));
+        glVertexAttribDivisor(3, 1);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
 
+void ParticleGenerator::uploadEmitted()
+{
+    if (this->emitted.empty())
+        return;
+    // with more emitted than there are slots, only the newest ones survive
+    size_t count = this->emitted.size();
+    size_t i = count > this->amount ? count - this->amount : 0;
+    glBindBuffer(GL_ARRAY_BUFFER, this->stateVBO[this->current]);
+    while (i < count)
+    {
+        // one upload per contiguous run of slots, so at most two unless the ring wrapped
+        unsigned int slot = static_cast<unsigned int>((this->emittedStart + i) % this->amount);
+        size_t run = std::min(count - i, static_cast<size_t>(this->amount - slot));
+        glBufferSubData(GL_ARRAY_BUFFER, slot * sizeof(Particle), run * sizeof(Particle), &this->emitted[i]);
+        i += run;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    this->emitted.clear();
+}
+
+void ParticleGenerator::init()
+{
     // create this->amount default particle instances
     for (unsigned int i = 0; i < this->amount; ++i)
         this->particles.push_back(Particle());
+    this->instances.reserve(this->amount);
 }
 
-// stores the index of the last particle used (for quick access to next dead particle)
-unsigned int lastUsedParticle = 0;
 unsigned int ParticleGenerator::firstUnusedParticle()
 {
     // first search from last used particle, this will usually return almost instantly
-    for (unsigned int i = lastUsedParticle; i < this->amount; ++i) {
+    for (unsigned int i = this->lastUsedParticle; i < this->amount; ++i) {
         if (this->particles[i].Life <= 0.0f) {
-            lastUsedParticle = i;
+            this->lastUsedParticle = i;
             return i;
         }
     }
     // otherwise, do a linear search
-    for (unsigned int i = 0; i < lastUsedParticle; ++i) {
+    for (unsigned int i = 0; i < this->lastUsedParticle; ++i) {
         if (this->particles[i].Life <= 0.0f) {
-            lastUsedParticle = i;
+            this->lastUsedParticle = i;
             return i;
         }
     }
     // all particles are taken, override the first one (note that if it repeatedly hits this case, more particles should be reserved)
-    lastUsedParticle = 0;
+    this->lastUsedParticle = 0;
     return 0;
 }
 
 void ParticleGenerator::respawnParticle(Particle& particle, GameObject& object, glm::vec2 offset)
 {
-    float random = ((rand() % 100) - 50) / 10.0f;
-    float rColor = 0.5f + ((rand() % 100) / 100.0f);
+    float random = (static_cast<int>(this->random.Below(100)) - 50) / 10.0f;
+    float rColor = 0.5f + (this->random.Below(100) / 100.0f);
     particle.Position = object.Position + random + offset;
     particle.Color = glm::vec4(rColor, rColor, rColor, 1.0f);
     particle.Life = 1.0f;
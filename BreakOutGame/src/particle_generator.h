@@ -16,9 +16,10 @@
 #include "shader.h"
 #include "texture.h"
 #include "game_object.h"
+#include "random.h"
 
 
-// Represents a single particle and its state
+// Represents a single particle and its state; also the vertex layout of the GPU simulation's buffers
 struct Particle {
     glm::vec2 Position, Velocity;
     glm::vec4 Color;
@@ -27,28 +28,81 @@ struct Particle {
     Particle() : Position(0.0f), Velocity(0.0f), Color(1.0f), Life(0.0f) { }
 };
 
+// Per-particle data as stored in the instance buffer
+struct ParticleInstance {
+    glm::vec2 Offset;
+    glm::vec4 Color;
+};
+
 
 // ParticleGenerator acts as a container for rendering a large number of 
 // particles by repeatedly spawning and updating particles and killing 
-// them after a given amount of time.
+// them after a given amount of time. Draw packs the live particles
+// into a streaming instance buffer and draws them all with a single
+// instanced call.
+// Given an update shader, the particles live on the GPU instead: two
+// buffers of particles take turns as source and transform feedback
+// target of the update, new particles are handed out round-robin and
+// only they are uploaded, and Draw reads the particles straight from
+// the latest buffer. All particles live equally long, so the oldest
+// one is always the next to die and round-robin reuses dead slots
+// just as the CPU path's search does.
 class ParticleGenerator
 {
 public:
+    // draw calls issued by Draw since this was last reset
+    unsigned int DrawCalls;
     // constructor
     ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount);
+    // constructor for the GPU simulation
+    ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount, Shader updateShader);
+    // constructs a generator that only simulates particles (no render state, Draw must not be called)
+    ParticleGenerator(unsigned int amount);
+    // destructor
+    ~ParticleGenerator();
+    // spawns newParticles particles at the object's position
+    void Emit(GameObject& object, unsigned int newParticles, glm::vec2 offset = glm::vec2(0.0f, 0.0f));
     // update all particles
-    void Update(float dt, GameObject& object, unsigned int newParticles, glm::vec2 offset = glm::vec2(0.0f, 0.0f));
+    void Update(float dt);
     // render all particles
     void Draw();
+    // restarts the particle random stream for the given seed
+    void Seed(uint64_t seed);
+    // copy of the state of all particles (read back from the GPU for the GPU simulation)
+    std::vector<Particle> Snapshot();
 private:
+    // the generator owns GL objects
+    ParticleGenerator(const ParticleGenerator&) = delete;
+    ParticleGenerator& operator=(const ParticleGenerator&) = delete;
     // state
     std::vector<Particle> particles;
     unsigned int amount;
+    // index of the last particle used (for quick access to next dead particle)
+    unsigned int lastUsedParticle;
+    // cosmetic randomness only, kept apart from the gameplay stream
+    Random random;
     // render state
     Shader shader;
     Texture2D texture;
-    unsigned int VAO;
+    unsigned int VAO, quadVBO, instanceVBO;
+    // live particles of the frame being drawn
+    std::vector<ParticleInstance> instances;
+    // GPU simulation state
+    bool                  gpu;
+    Shader                updateShader;
+    Uniform<float>        dtUniform;
+    unsigned int          stateVBO[2], updateVAO[2], drawVAO[2];
+    unsigned int          current;      // buffer holding the latest state
+    unsigned int          nextSlot;     // slot the next emitted particle goes to
+    unsigned int          emittedStart; // slot of emitted.front()
+    std::vector<Particle> emitted;      // emitted since the last upload, in consecutive slots
     // initializes buffer and vertex attributes
+    void initRenderData();
+    // initializes the particle buffers and vertex arrays of the GPU simulation
+    void initGpuData();
+    // writes the particles emitted since the last call into the latest GPU buffer
+    void uploadEmitted();
+    // creates this->amount default particle instances
     void init();
     // returns the first Particle index that's currently unused e.g. Life <= 0.0f or 0 if no particle is currently inactive
     unsigned int firstUnusedParticle();
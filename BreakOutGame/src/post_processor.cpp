@@ -8,24 +8,63 @@
 ******************************************************************/
 #include "post_processor.h"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
-PostProcessor::PostProcessor(Shader shader, unsigned int width, unsigned int height)
-    : PostProcessingShader(shader), Texture(), Width(width), Height(height), Confuse(false), Chaos(false), Shake(false)
+static const char* ANTI_ALIASING_NAMES[AA_MODE_COUNT] = { "off", "2x", "4x", "8x", "fxaa" };
+
+const char* AntiAliasingName(AntiAliasingMode mode)
+{
+    return mode < AA_MODE_COUNT ? ANTI_ALIASING_NAMES[mode] : "unknown";
+}
+
+bool ParseAntiAliasing(const char* name, AntiAliasingMode& mode)
+{
+    for (int i = 0; i < AA_MODE_COUNT; ++i)
+    {
+        if (std::strcmp(name, ANTI_ALIASING_NAMES[i]) == 0)
+        {
+            mode = static_cast<AntiAliasingMode>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// whether the window's color buffer is plain 8-bit RGBA, the format of the multisampled buffer
+static bool screenIsRGBA8()
 {
-    // initialize renderbuffer/framebuffer object
+    GLint buffer = GL_BACK, type = 0, encoding = 0, red = 0, green = 0, blue = 0, alpha = 0;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glGetIntegerv(GL_DRAW_BUFFER, &buffer);
+    // the default framebuffer names its buffers GL_BACK_LEFT etc. here, not GL_BACK
+    if (buffer == GL_BACK)
+        buffer = GL_BACK_LEFT;
+    else if (buffer == GL_FRONT)
+        buffer = GL_FRONT_LEFT;
+    glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, buffer, GL_FRAMEBUFFER_ATTACHMENT_COMPONENT_TYPE, &type);
+    glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, buffer, GL_FRAMEBUFFER_ATTACHMENT_COLOR_ENCODING, &encoding);
+    glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, buffer, GL_FRAMEBUFFER_ATTACHMENT_RED_SIZE, &red);
+    glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, buffer, GL_FRAMEBUFFER_ATTACHMENT_GREEN_SIZE, &green);
+    glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, buffer, GL_FRAMEBUFFER_ATTACHMENT_BLUE_SIZE, &blue);
+    glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, buffer, GL_FRAMEBUFFER_ATTACHMENT_ALPHA_SIZE, &alpha);
+    return type == GL_UNSIGNED_NORMALIZED && encoding == GL_LINEAR && red == 8 && green == 8 && blue == 8 && alpha == 8;
+}
+
+PostProcessor::PostProcessor(Shader shader, Shader fxaaShader, unsigned int width, unsigned int height, AntiAliasingMode antiAliasing)
+    : PostProcessingShader(shader), FxaaShader(fxaaShader), Texture(), Width(width), Height(height), DrawCalls(0), antiAliasing(AA_OFF), samples(0), effects(false), screenMatches(screenIsRGBA8())
+{
+    // initialize renderbuffer/framebuffer object; the multisampled storage is allocated by SetAntiAliasing
     glGenFramebuffers(1, &this->MSFBO);
     glGenFramebuffers(1, &this->FBO);
     glGenRenderbuffers(1, &this->RBO);
-    // initialize renderbuffer storage with a multisampled color buffer (don't need a depth/stencil buffer)
-    glBindFramebuffer(GL_FRAMEBUFFER, this->MSFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, this->RBO);
-    glRenderbufferStorageMultisample(GL_RENDERBUFFER, 4, GL_RGB, width, height); // allocate storage for render buffer object
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->RBO); // attach MS render buffer object to framebuffer
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "ERROR::POSTPROCESSOR: Failed to initialize MSFBO" << std::endl;
-    // also initialize the FBO/texture to blit multisampled color-buffer to; used for shader operations (for postprocessing effects)
+    this->SetAntiAliasing(antiAliasing);
+    // also initialize the FBO/texture to blit multisampled color-buffer to; used for shader operations (for postprocessing effects).
+    // It is RGBA8 like the multisampled buffer and the window, so resolving between them never converts formats
     glBindFramebuffer(GL_FRAMEBUFFER, this->FBO);
+    this->Texture.Internal_Format = GL_RGBA8;
+    this->Texture.Image_Format = GL_RGBA;
     this->Texture.Generate(width, height, NULL);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->Texture.ID, 0); // attach texture to framebuffer as its color attachment
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
@@ -60,37 +99,91 @@ PostProcessor::PostProcessor(Shader shader, unsigned int width, unsigned int hei
         1.0f / 16.0f, 2.0f / 16.0f, 1.0f / 16.0f
     };
     glUniform1fv(glGetUniformLocation(this->PostProcessingShader.ID, "blur_kernel"), 9, blur_kernel);
+    this->FxaaShader.SetInteger("scene", 0, true);
+    this->texelSizeUniform = this->FxaaShader.GetUniform<glm::vec2>("texelSize");
+    this->texelSizeUniform.Set(glm::vec2(1.0f / width, 1.0f / height));
 }
 
-void PostProcessor::BeginRender()
+void PostProcessor::SetAntiAliasing(AntiAliasingMode mode)
 {
+    static const unsigned int MODE_SAMPLES[AA_MODE_COUNT] = { 0, 2, 4, 8, 0 };
+    this->antiAliasing = mode;
+    unsigned int samples = MODE_SAMPLES[mode];
+    if (samples > 0)
+    {
+        int maxSamples = 0;
+        glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+        samples = std::min(samples, static_cast<unsigned int>(std::max(maxSamples, 1)));
+    }
+    if (samples == this->samples)
+        return;
+    this->samples = samples;
+    if (samples == 0)
+        return; // the old storage stays allocated but unused
+    // initialize renderbuffer storage with a multisampled color buffer (don't need a depth/stencil buffer)
     glBindFramebuffer(GL_FRAMEBUFFER, this->MSFBO);
+    glBindRenderbuffer(GL_RENDERBUFFER, this->RBO);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, this->Width, this->Height); // allocate storage for render buffer object
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->RBO); // attach MS render buffer object to framebuffer
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::POSTPROCESSOR: Failed to initialize MSFBO" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void PostProcessor::BeginRender(bool effects)
+{
+    this->effects = effects;
+    // without MSAA the scene either goes straight to the screen or, when a pass reads it, into the texture
+    if (this->samples > 0)
+        glBindFramebuffer(GL_FRAMEBUFFER, this->MSFBO);
+    else if (effects || this->antiAliasing == AA_FXAA)
+        glBindFramebuffer(GL_FRAMEBUFFER, this->FBO);
+    else
+        return; // the screen was cleared for the frame already
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 }
 void PostProcessor::EndRender()
 {
-    // now resolve multisampled color-buffer into intermediate FBO to store to texture
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, this->MSFBO);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->FBO);
-    glBlitFramebuffer(0, 0, this->Width, this->Height, 0, 0, this->Width, this->Height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    if (this->samples > 0)
+    {
+        // now resolve multisampled color-buffer into intermediate FBO to store to texture, or directly onto the screen when
+        // no effect reads it and the screen takes a resolve (same format, and a viewport of exactly the scene's size)
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        bool direct = !this->effects && this->screenMatches && viewport[0] == 0 && viewport[1] == 0
+            && viewport[2] == static_cast<GLint>(this->Width) && viewport[3] == static_cast<GLint>(this->Height);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, this->MSFBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->effects || !direct ? this->FBO : 0);
+        glBlitFramebuffer(0, 0, this->Width, this->Height, 0, 0, this->Width, this->Height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        if (!this->effects && !direct)
+        {
+            // a single-sampled blit may convert and scale
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, this->FBO);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+            glBlitFramebuffer(0, 0, this->Width, this->Height, viewport[0], viewport[1], viewport[0] + viewport[2], viewport[1] + viewport[3],
+                GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        }
+    }
     glBindFramebuffer(GL_FRAMEBUFFER, 0); // binds both READ and WRITE framebuffer to default framebuffer
 }
 
-void PostProcessor::Render(float time)
+void PostProcessor::Render()
 {
-    // set uniforms/options
-    this->PostProcessingShader.Use();
-    this->PostProcessingShader.SetFloat("time", time);
-    this->PostProcessingShader.SetInteger("confuse", this->Confuse);
-    this->PostProcessingShader.SetInteger("chaos", this->Chaos);
-    this->PostProcessingShader.SetInteger("shake", this->Shake);
+    // effects take precedence over FXAA; with neither the scene is on the screen already
+    if (this->effects)
+        this->PostProcessingShader.Use();
+    else if (this->antiAliasing == AA_FXAA)
+        this->FxaaShader.Use();
+    else
+        return;
     // render textured quad
     glActiveTexture(GL_TEXTURE0);
     this->Texture.Bind();
     glBindVertexArray(this->VAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
     glBindVertexArray(0);
+    ++this->DrawCalls;
 }
 
 void PostProcessor::initRenderData()
@@ -17,34 +17,64 @@
 #include "shader.h"
 
 
+// Anti-aliasing applied to the game scene
+enum AntiAliasingMode {
+    AA_OFF,
+    AA_MSAA_2X,
+    AA_MSAA_4X,
+    AA_MSAA_8X,
+    AA_FXAA,  // single-sampled scene smoothed by a fullscreen FXAA pass
+    AA_MODE_COUNT
+};
+// name of a mode as used on the command line ("off", "2x", "4x", "8x", "fxaa")
+const char* AntiAliasingName(AntiAliasingMode mode);
+// parses a mode name; false if there is no such mode
+bool ParseAntiAliasing(const char* name, AntiAliasingMode& mode);
+
+
 // PostProcessor hosts all PostProcessing effects for the Breakout
-// Game. It renders the game on a textured quad after which one can
-// enable specific effects by enabling either the Confuse, Chaos or 
-// Shake boolean. 
+// Game. It renders the game on a textured quad; which effects apply
+// (confuse, chaos or shake) and the time driving them come from the
+// FrameData uniform block.
 // It is required to call BeginRender() before rendering the game
 // and EndRender() after rendering the game for the class to work.
+// When no effect is active the scene skips the offscreen texture: it
+// goes straight to the screen, through a multisampled buffer resolved
+// onto the screen, or through the FXAA pass, depending on the mode.
+// A resolve can neither convert formats nor scale, so on a screen
+// that isn't RGBA8 of the scene's size it goes through the texture
+// and is then copied onto the screen.
 class PostProcessor
 {
 public:
     // state
     Shader PostProcessingShader;
+    Shader FxaaShader;
     Texture2D Texture;
     unsigned int Width, Height;
-    // options
-    bool Confuse, Chaos, Shake;
+    // fullscreen passes drawn since this was last reset
+    unsigned int DrawCalls;
     // constructor
-    PostProcessor(Shader shader, unsigned int width, unsigned int height);
-    // prepares the postprocessor's framebuffer operations before rendering the game
-    void BeginRender();
-    // should be called after rendering the game, so it stores all the rendered data into a texture object
+    PostProcessor(Shader shader, Shader fxaaShader, unsigned int width, unsigned int height, AntiAliasingMode antiAliasing = AA_MSAA_4X);
+    // switches anti-aliasing; MSAA falls back to the largest sample count the driver supports
+    void SetAntiAliasing(AntiAliasingMode mode);
+    AntiAliasingMode GetAntiAliasing() const { return this->antiAliasing; }
+    // prepares the postprocessor's framebuffer operations before rendering the game; effects tells whether any effect is active
+    void BeginRender(bool effects);
+    // should be called after rendering the game, so it stores all the rendered data into a texture object (or onto the screen)
     void EndRender();
-    // renders the PostProcessor texture quad (as a screen-encompassing large sprite)
-    void Render(float time);
+    // renders the PostProcessor texture quad (as a screen-encompassing large sprite), if this frame needs it
+    void Render();
 private:
     // render state
     unsigned int MSFBO, FBO; // MSFBO = Multisampled FBO. FBO is regular, used for blitting MS color-buffer to texture
     unsigned int RBO; // RBO is used for multisampled color buffer
     unsigned int VAO;
+    AntiAliasingMode antiAliasing;
+    unsigned int samples; // of the RBO, 0 without MSAA
+    bool effects; // of the frame being rendered
+    bool screenMatches; // the window's color buffer has the multisampled buffer's format
+    Uniform<glm::vec2> texelSizeUniform;
     // initialize quad for rendering postprocessing texture
     void initRenderData();
 };
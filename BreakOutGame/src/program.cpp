@@ -11,22 +11,210 @@
 
 #include "game.h"
 #include "resource_manager.h"
+#include "headless_runner.h"
+#include "batch_runner.h"
+#include "replay.h"
+#include "benchmarks.h"
+#include "file_system.h"
+#include "asset_pack.h"
+#include "cooked_texture.h"
 
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
 
 // GLFW function declarations
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mode);
+// runs the simulation without window, GL context or audio device, optionally recording its input
+int run_headless(unsigned int ticks, float dt, const char* recordFile);
+// plays a replay log headless at full speed and reports whether it reproduced the recorded state
+int run_replay(const ReplayLog& log);
+// prints the outcome of a replay
+void report_replay(const ReplayPlayer& player, double seconds);
+// frame statistics printed by --stats
+struct FrameTimes {
+    unsigned int       Frames;
+    double             CpuSeconds;   // simulation steps plus Render, i.e. everything but waiting on the swap
+    double             FrameSeconds; // whole frames
+    unsigned long long DrawCalls, Sprites, TextLayouts;
+    unsigned long long NameLookups;  // resources looked up by name, in steps and Render
+};
+void report_frames(const char* label, const FrameTimes& times);
+// plays many headless games in parallel and prints aggregate stats
+int run_batch(unsigned int games, unsigned int maxTicks, unsigned int threads, float dt);
+// monotonic clock in nanoseconds
+uint64_t monotonic_ns();
 
 // The Width of the screen
 const unsigned int SCREEN_WIDTH = 800;
 // The height of the screen
 const unsigned int SCREEN_HEIGHT = 600;
+// Default simulation rate in ticks per second (override with --rate)
+const unsigned int SIMULATION_RATE = 120;
+// Maximum number of simulation steps run to catch up before a frame is rendered
+const unsigned int MAX_CATCH_UP_STEPS = 8;
+// Ticks to simulate when --headless is given without a count
+const unsigned int HEADLESS_TICKS = 100000;
+// Tick budget per game of a --batch run when no count is given (5 minutes at the default rate)
+const unsigned int BATCH_TICKS = 36000;
+// Asset roots searched after the ones given with --mount: the source tree seen from the project
+// directory (the working directory when started from Visual Studio)
+const char* const DEFAULT_MOUNTS[] = { "src" };
 
 Game Breakout(SCREEN_WIDTH, SCREEN_HEIGHT);
 
 int main(int argc, char* argv[])
 {
+    // command line: [--rate ticks_per_second] [--headless [ticks]] [--record file] [--replay file]
+    //               [--batch games [ticks]] [--threads n] [--bench name] [--stats] [--gpu-particles]
+    //               [--aa off|2x|4x|8x|fxaa] (F1 cycles anti-aliasing while playing)
+    //               [--mount dir]... [--pack file]... [--build-pack file [root]] [--cook [root]] [--bc1]
+    uint64_t startupStart = monotonic_ns();
+    unsigned int rate = SIMULATION_RATE;
+    const char* recordFile = nullptr;
+    const char* replayFile = nullptr;
+    bool headless = false;
+    unsigned int ticks = HEADLESS_TICKS;
+    unsigned int batchGames = 0, batchTicks = BATCH_TICKS, threads = 0;
+    bool stats = false;
+    const char* benchmark = nullptr;
+    std::vector<std::pair<const char*, bool>> mounts; // path, and whether it is a pack
+    const char* packOutput = nullptr;
+    const char* packRoot = DEFAULT_MOUNTS[0];
+    bool cook = false, compress = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+        {
+            unsigned long value = std::strtoul(argv[++i], nullptr, 10);
+            if (value == 0 || value > MAX_SIMULATION_RATE)
+            {
+                std::cout << "Simulation rate must be between 1 and " << MAX_SIMULATION_RATE << " ticks per second" << std::endl;
+                return -1;
+            }
+            rate = static_cast<unsigned int>(value);
+        }
+        else if (std::strcmp(argv[i], "--headless") == 0)
+        {
+            headless = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                ticks = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+        {
+            batchGames = std::strtoul(argv[++i], nullptr, 10);
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                batchTicks = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--stats") == 0)
+            stats = true;
+        else if (std::strcmp(argv[i], "--gpu-particles") == 0)
+            Breakout.GpuParticles = true;
+        else if (std::strcmp(argv[i], "--aa") == 0 && i + 1 < argc)
+        {
+            if (!ParseAntiAliasing(argv[++i], Breakout.AntiAliasing))
+            {
+                std::cout << "Unknown anti-aliasing mode: " << argv[i] << std::endl;
+                return -1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            recordFile = argv[++i];
+        else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+            replayFile = argv[++i];
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = std::strtoul(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--mount") == 0 && i + 1 < argc)
+            mounts.push_back(std::make_pair(argv[++i], false));
+        else if (std::strcmp(argv[i], "--pack") == 0 && i + 1 < argc)
+            mounts.push_back(std::make_pair(argv[++i], true));
+        else if (std::strcmp(argv[i], "--build-pack") == 0 && i + 1 < argc)
+        {
+            packOutput = argv[++i];
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                packRoot = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--cook") == 0)
+        {
+            cook = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                packRoot = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--bc1") == 0)
+            compress = true;
+        else if (std::strcmp(argv[i], "--bench") == 0 && i + 1 < argc)
+            benchmark = argv[++i];
+    }
+    // cooking comes first, so a pack built in the same run holds the cooked textures
+    if (cook)
+    {
+        int textures = CookTextures(packRoot, "textures", compress);
+        if (textures < 0)
+            return -1;
+        std::cout << "Cooked " << textures << " textures in " << packRoot << "/textures" << (compress ? " (BC1 where opaque)" : "") << std::endl;
+        if (!packOutput)
+            return 0;
+    }
+    if (packOutput)
+    {
+        std::vector<std::string> folders(std::begin(ASSET_PACK_FOLDERS), std::end(ASSET_PACK_FOLDERS));
+        int files = BuildAssetPack(packRoot, folders, packOutput);
+        if (files < 0)
+            return -1;
+        std::cout << "Packed " << files << " files from " << packRoot << " into " << packOutput << std::endl;
+        return 0;
+    }
+    // assets resolve against the given mounts first, in order, then against the defaults
+    for (const std::pair<const char*, bool>& mount : mounts)
+    {
+        if (!mount.second)
+        {
+            FileSystem::MountDirectory(mount.first);
+            continue;
+        }
+        std::unique_ptr<PackMount> pack(new PackMount(mount.first));
+        if (!pack->Valid())
+            return -1;
+        FileSystem::Mount(std::move(pack));
+    }
+    for (const char* mount : DEFAULT_MOUNTS)
+        FileSystem::MountDirectory(mount);
+    if (benchmark)
+    {
+        bool passed;
+        if (!RunBenchmark(benchmark, passed))
+        {
+            std::cout << "Unknown benchmark: " << benchmark << std::endl;
+            return -1;
+        }
+        return passed ? 0 : 1;
+    }
+    // a replay runs at the rate it was recorded at
+    ReplayLog replayLog;
+    if (replayFile)
+    {
+        if (!replayLog.Load(replayFile))
+            return -1;
+        rate = replayLog.Rate;
+    }
+    // every simulation tick advances the game by exactly this amount
+    const uint64_t stepNs = 1000000000ull / rate;
+    const float dt = 1.0f / rate;
+
+    if (batchGames > 0)
+        return run_batch(batchGames, batchTicks, threads, dt);
+    if (headless && replayFile)
+        return run_replay(replayLog);
+    if (headless)
+        return run_headless(ticks, dt, recordFile);
+
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -58,38 +246,113 @@ int main(int argc, char* argv[])
 
     // initialize game
     // ---------------
+    uint64_t initStart = monotonic_ns();
     Breakout.Init();
+    if (stats)
+        std::cout << "Startup: Init took " << (monotonic_ns() - initStart) * 1e-6 << " ms" << std::endl;
+
+    // input comes from the keyboard, optionally recorded, or from a replay log
+    ReplayRecorder* recorder = nullptr;
+    ReplayPlayer* replayer = nullptr;
+    bool replayReported = false;
+    if (replayFile)
+        replayer = new ReplayPlayer(Breakout, replayLog);
+    else if (recordFile)
+        recorder = new ReplayRecorder(Breakout, rate, static_cast<uint32_t>(monotonic_ns()));
 
-    // deltaTime variables
-    // -------------------
-    float deltaTime = 0.0f;
-    float lastFrame = 0.0f;
+    // fixed timestep variables
+    // ------------------------
+    uint64_t lastFrame = monotonic_ns();
+    uint64_t accumulator = 0;
+    // --stats: totals over the whole run and over the current second
+    FrameTimes total = FrameTimes(), second = FrameTimes();
+    bool firstFrame = true;
 
     while (!glfwWindowShouldClose(window))
     {
-        // calculate delta time
-        // --------------------
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
+        // accumulate elapsed time
+        // -----------------------
+        uint64_t currentFrame = monotonic_ns();
+        unsigned int frameLookups = ResourceManager::NameLookups;
+        accumulator += currentFrame - lastFrame;
         lastFrame = currentFrame;
         glfwPollEvents();
 
-        // manage user input
-        // -----------------
-        Breakout.ProcessInput(deltaTime);
-
-        // update game state
-        // -----------------
-        Breakout.Update(deltaTime);
+        // manage user input and update game state in fixed steps
+        // ------------------------------------------------------
+        unsigned int steps = 0;
+        while (accumulator >= stepNs && steps < MAX_CATCH_UP_STEPS)
+        {
+            if (replayer)
+            {
+                // the game stays on its final state once the log runs out
+                if (!replayer->Step() && !replayReported)
+                {
+                    report_replay(*replayer, 0.0);
+                    replayReported = true;
+                }
+            }
+            else if (recorder)
+                recorder->Step(dt);
+            else
+                Breakout.Step(dt);
+            accumulator -= stepNs;
+            ++steps;
+        }
+        // after a long hitch drop the backlog instead of spiralling trying to catch up
+        if (accumulator >= stepNs)
+            accumulator %= stepNs;
 
-        // render
-        // ------
+        // render, interpolating between the last two simulation states
+        // ------------------------------------------------------------
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
-        Breakout.Render();
+        Breakout.Render(static_cast<float>(accumulator) / stepNs);
+        Breakout.EndFrame();
+        uint64_t cpuNs = monotonic_ns() - currentFrame;
 
         glfwSwapBuffers(window);
+        if (firstFrame)
+        {
+            if (stats)
+                std::cout << "Startup: first frame after " << (monotonic_ns() - startupStart) * 1e-6 << " ms" << std::endl;
+            firstFrame = false;
+        }
+
+        if (stats)
+        {
+            second.Frames++;
+            second.CpuSeconds += cpuNs * 1e-9;
+            second.FrameSeconds += (monotonic_ns() - currentFrame) * 1e-9;
+            second.DrawCalls += Breakout.Rendered.DrawCalls;
+            second.Sprites += Breakout.Rendered.Sprites;
+            second.TextLayouts += Breakout.Rendered.TextLayouts;
+            second.NameLookups += ResourceManager::NameLookups - frameLookups;
+            if (second.FrameSeconds >= 1.0)
+            {
+                report_frames("Frame stats", second);
+                total.Frames += second.Frames;
+                total.CpuSeconds += second.CpuSeconds;
+                total.FrameSeconds += second.FrameSeconds;
+                total.DrawCalls += second.DrawCalls;
+                total.Sprites += second.Sprites;
+                total.TextLayouts += second.TextLayouts;
+                total.NameLookups += second.NameLookups;
+                second = FrameTimes();
+            }
+        }
+    }
+
+    if (stats && total.Frames > 0)
+        report_frames("Frame stats (whole run)", total);
+    if (stats)
+        std::cout << "File system: " << FileSystem::Lookups << " path lookups, " << FileSystem::Misses << " searched the mounts" << std::endl;
+    if (recorder)
+    {
+        recorder->Log.Save(recordFile);
+        delete recorder;
     }
+    delete replayer;
 
     // delete all resources as loaded using the resource manager
     // ---------------------------------------------------------
@@ -104,6 +367,12 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     // when a user presses the escape key, we set the WindowShouldClose property to true, closing the application
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
+    // F1 cycles through the anti-aliasing modes
+    if (key == GLFW_KEY_F1 && action == GLFW_PRESS)
+    {
+        Breakout.SetAntiAliasing(static_cast<AntiAliasingMode>((Breakout.AntiAliasing + 1) % AA_MODE_COUNT));
+        std::cout << "Anti-aliasing: " << AntiAliasingName(Breakout.AntiAliasing) << std::endl;
+    }
     if (key >= 0 && key < 1024)
     {
         if (action == GLFW_PRESS)
@@ -121,4 +390,90 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     // make sure the viewport matches the new window dimensions; note that width and 
     // height will be significantly larger than specified on retina displays.
     glViewport(0, 0, width, height);
-}
\ No newline at end of file
+}
+
+uint64_t monotonic_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int run_headless(unsigned int ticks, float dt, const char* recordFile)
+{
+    // initialize the simulation only; no GLFW, GL or audio calls are made from here on
+    Breakout.Headless = true;
+    Breakout.Init();
+
+    ReplayRecorder* recorder = recordFile ? new ReplayRecorder(Breakout, static_cast<unsigned int>(1.0f / dt + 0.5f), static_cast<uint32_t>(monotonic_ns())) : nullptr;
+    HeadlessRunner runner(Breakout, dt, recorder);
+    HeadlessStats stats = runner.Run(ticks);
+    std::cout << "Headless: " << stats.Ticks << " ticks in " << stats.Seconds << " s ("
+        << stats.TicksPerSecond << " ticks/s)" << std::endl;
+    if (recorder)
+    {
+        bool saved = recorder->Log.Save(recordFile);
+        delete recorder;
+        if (!saved)
+            return -1;
+    }
+    return 0;
+}
+
+int run_replay(const ReplayLog& log)
+{
+    Breakout.Headless = true;
+    Breakout.Init();
+
+    ReplayPlayer player(Breakout, log);
+    double seconds = player.Run();
+    report_replay(player, seconds);
+    return player.FirstDivergence() < 0 ? 0 : 1;
+}
+
+void report_replay(const ReplayPlayer& player, double seconds)
+{
+    std::cout << "Replay: " << player.Tick() << " ticks";
+    if (seconds > 0.0)
+        std::cout << " in " << seconds << " s (" << player.Tick() / seconds << " ticks/s)";
+    if (player.FirstDivergence() < 0)
+        std::cout << ", state matches the recording at every tick" << std::endl;
+    else
+        std::cout << ", state diverges from the recording at tick " << player.FirstDivergence() << std::endl;
+}
+
+int run_batch(unsigned int games, unsigned int maxTicks, unsigned int threads, float dt)
+{
+    JobSystem jobs(threads);
+    BatchRunner runner(jobs, dt, maxTicks);
+    runner.Run(games);
+    std::cout << "Batch: " << games << " games, " << runner.Ticks << " ticks in " << runner.Seconds << " s on "
+        << jobs.ThreadCount() << " threads (" << games / runner.Seconds << " games/s, "
+        << runner.Ticks / runner.Seconds << " ticks/s)" << std::endl;
+    for (int level = -1; level < 4; ++level)
+    {
+        BatchStats stats = runner.Aggregate(level);
+        if (stats.Games == 0)
+            continue;
+        if (level < 0)
+            std::cout << "  all levels:";
+        else
+            std::cout << "  level " << level + 1 << ":";
+        std::cout << " completed " << stats.Completed << "/" << stats.Games;
+        if (stats.Completed > 0)
+            std::cout << " in " << stats.MeanCompletionSeconds << " s (min " << stats.MinCompletionSeconds << ", max " << stats.MaxCompletionSeconds << ")";
+        std::cout << ", lives lost " << stats.MeanLivesLost << ", power-ups " << stats.MeanPowerUpsCollected
+            << ", bricks " << stats.MeanBricksDestroyed << " per game" << std::endl;
+    }
+    return 0;
+}
+
+void report_frames(const char* label, const FrameTimes& times)
+{
+    std::cout << label << ": " << times.Frames / times.FrameSeconds << " fps, "
+        << times.CpuSeconds * 1000.0 / times.Frames << " ms CPU per frame, "
+        << times.FrameSeconds * 1000.0 / times.Frames << " ms per frame, "
+        << static_cast<double>(times.DrawCalls) / times.Frames << " draw calls, "
+        << static_cast<double>(times.Sprites) / times.Frames << " sprites, "
+        << static_cast<double>(times.TextLayouts) / times.Frames << " text layouts and "
+        << static_cast<double>(times.NameLookups) / times.Frames << " resource name lookups per frame" << std::endl;
+}
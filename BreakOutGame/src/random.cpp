@@ -0,0 +1,50 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include "random.h"
+
+
+Random::Random()
+{
+    this->Seed(0, "");
+}
+
+Random::Random(uint64_t seed, const char* stream)
+{
+    this->Seed(seed, stream);
+}
+
+void Random::Seed(uint64_t seed, const char* stream)
+{
+    // the stream name is hashed (FNV-1a) into the increment, which has to be odd
+    uint64_t hash = 14695981039346656037ull;
+    for (const char* c = stream; *c; ++c)
+        hash = (hash ^ static_cast<unsigned char>(*c)) * 1099511628211ull;
+    this->state = 0;
+    this->increment = (hash << 1) | 1u;
+    this->NextU32();
+    this->state += seed;
+    this->NextU32();
+}
+
+unsigned int Random::Below(unsigned int bound)
+{
+    // Lemire's multiply-shift: map 32 random bits onto [0, bound) and reject the few values that would bias it
+    uint64_t product = static_cast<uint64_t>(this->NextU32()) * bound;
+    uint32_t low = static_cast<uint32_t>(product);
+    if (low < bound)
+    {
+        uint32_t threshold = (0u - bound) % bound;
+        while (low < threshold)
+        {
+            product = static_cast<uint64_t>(this->NextU32()) * bound;
+            low = static_cast<uint32_t>(product);
+        }
+    }
+    return static_cast<unsigned int>(product >> 32);
+}
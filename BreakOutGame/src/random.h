@@ -0,0 +1,50 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cstdint>
+
+
+// Random is a small PCG32 generator: 64 bits of state, 32-bit
+// output and a stream selector, so generators built from the same
+// seed but different stream names produce independent sequences.
+// Every Game owns its generators (one stream per consumer), which
+// keeps cosmetic randomness from shifting gameplay randomness and
+// lets games run on separate threads without shared state. The
+// sequence only depends on the seed, not on the platform's rand().
+class Random
+{
+public:
+    // constructor(s)
+    Random();
+    Random(uint64_t seed, const char* stream);
+    // restarts the sequence of the named stream for the given seed
+    void         Seed(uint64_t seed, const char* stream);
+    // uniformly distributed 32 bits
+    uint32_t     NextU32()
+    {
+        uint64_t old = this->state;
+        this->state = old * 6364136223846793005ull + this->increment;
+        uint32_t xorshifted = static_cast<uint32_t>(((old >> 18u) ^ old) >> 27u);
+        uint32_t rotation = static_cast<uint32_t>(old >> 59u);
+        return (xorshifted >> rotation) | (xorshifted << ((32u - rotation) & 31u));
+    }
+    // uniformly distributed in [0, bound) without modulo bias; bound must be > 0
+    unsigned int Below(unsigned int bound);
+    // uniformly distributed in [0, 1)
+    float        NextFloat() { return (this->NextU32() >> 8) * (1.0f / 16777216.0f); }
+    // true with a chance of 1 in chance
+    bool         OneIn(unsigned int chance) { return this->Below(chance) == 0; }
+private:
+    uint64_t state;
+    uint64_t increment; // odd; selects the stream
+};
+
+#endif
@@ -0,0 +1,228 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include "replay.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+
+// file layout (little-endian): "BRPL", version, rate, seed, initial checksum, tick count, run count,
+// then every run as a key mask (u16) and a varint length, then one u32 checksum per tick
+static const char     REPLAY_MAGIC[4] = { 'B', 'R', 'P', 'L' };
+static const uint32_t REPLAY_VERSION = 1;
+
+static void writeU16(std::ostream& out, uint16_t value)
+{
+    char bytes[2] = { static_cast<char>(value & 0xFF), static_cast<char>(value >> 8) };
+    out.write(bytes, 2);
+}
+
+static void writeU32(std::ostream& out, uint32_t value)
+{
+    char bytes[4];
+    for (int i = 0; i < 4; ++i)
+        bytes[i] = static_cast<char>((value >> (i * 8)) & 0xFF);
+    out.write(bytes, 4);
+}
+
+static void writeVarint(std::ostream& out, uint32_t value)
+{
+    // 7 bits per byte, high bit set while more bytes follow
+    while (value >= 0x80)
+    {
+        out.put(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.put(static_cast<char>(value));
+}
+
+static bool readU16(std::istream& in, uint16_t& value)
+{
+    unsigned char bytes[2];
+    if (!in.read(reinterpret_cast<char*>(bytes), 2))
+        return false;
+    value = static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+    return true;
+}
+
+static bool readU32(std::istream& in, uint32_t& value)
+{
+    unsigned char bytes[4];
+    if (!in.read(reinterpret_cast<char*>(bytes), 4))
+        return false;
+    value = 0;
+    for (int i = 0; i < 4; ++i)
+        value |= static_cast<uint32_t>(bytes[i]) << (i * 8);
+    return true;
+}
+
+static bool readVarint(std::istream& in, uint32_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        int byte = in.get();
+        if (byte == std::char_traits<char>::eof())
+            return false;
+        // the fifth byte only has the top 4 bits of a 32-bit value left, and nothing may follow it
+        if (shift == 28 && (byte & 0xF0))
+            return false;
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+uint16_t CaptureInput(const Game& game)
+{
+    uint16_t mask = 0;
+    for (unsigned int i = 0; i < REPLAY_KEY_COUNT; ++i)
+    {
+        if (game.Keys[REPLAY_KEYS[i]])
+            mask |= 1 << i;
+        if (game.KeysProcessed[REPLAY_KEYS[i]])
+            mask |= 1 << (REPLAY_KEY_COUNT + i);
+    }
+    return mask;
+}
+
+void ApplyInput(Game& game, uint16_t mask)
+{
+    for (unsigned int i = 0; i < REPLAY_KEY_COUNT; ++i)
+    {
+        game.Keys[REPLAY_KEYS[i]] = (mask >> i) & 1;
+        game.KeysProcessed[REPLAY_KEYS[i]] = (mask >> (REPLAY_KEY_COUNT + i)) & 1;
+    }
+}
+
+bool ReplayLog::Save(const char* file) const
+{
+    std::ofstream out(file, std::ios::binary);
+    if (!out)
+    {
+        std::cout << "ERROR::REPLAY: Failed to open " << file << " for writing" << std::endl;
+        return false;
+    }
+    // collapse the per-tick masks into runs of identical input
+    std::vector<std::pair<uint16_t, uint32_t>> runs;
+    for (uint16_t mask : this->Inputs)
+    {
+        if (!runs.empty() && runs.back().first == mask)
+            ++runs.back().second;
+        else
+            runs.push_back(std::make_pair(mask, 1u));
+    }
+    out.write(REPLAY_MAGIC, 4);
+    writeU32(out, REPLAY_VERSION);
+    writeU32(out, this->Rate);
+    writeU32(out, this->Seed);
+    writeU32(out, this->Initial);
+    writeU32(out, static_cast<uint32_t>(this->Inputs.size()));
+    writeU32(out, static_cast<uint32_t>(runs.size()));
+    for (const std::pair<uint16_t, uint32_t>& run : runs)
+    {
+        writeU16(out, run.first);
+        writeVarint(out, run.second);
+    }
+    for (uint32_t checksum : this->Checksums)
+        writeU32(out, checksum);
+    return static_cast<bool>(out);
+}
+
+bool ReplayLog::Load(const char* file)
+{
+    std::ifstream in(file, std::ios::binary);
+    char magic[4];
+    uint32_t version = 0, ticks = 0, runCount = 0;
+    if (!in || !in.read(magic, 4) || std::char_traits<char>::compare(magic, REPLAY_MAGIC, 4) != 0
+        || !readU32(in, version) || version != REPLAY_VERSION)
+    {
+        std::cout << "ERROR::REPLAY: " << file << " is not a replay file" << std::endl;
+        return false;
+    }
+    uint32_t rate = 0;
+    bool ok = readU32(in, rate) && readU32(in, this->Seed) && readU32(in, this->Initial)
+        && readU32(in, ticks) && readU32(in, runCount);
+    // the rate sets the length of a tick, so one out of range can't be played back
+    ok = ok && rate > 0 && rate <= MAX_SIMULATION_RATE;
+    this->Rate = rate;
+    this->Inputs.clear();
+    this->Checksums.clear();
+    // nothing is allocated for more than the file can hold: every tick has a 4-byte checksum, every run at least 3 bytes
+    if (ok)
+    {
+        std::streamoff start = in.tellg();
+        in.seekg(0, std::ios::end);
+        uint64_t remaining = static_cast<uint64_t>(in.tellg() - start);
+        in.seekg(start);
+        ok = static_cast<uint64_t>(ticks) * 4 + static_cast<uint64_t>(runCount) * 3 <= remaining;
+    }
+    for (uint32_t i = 0; ok && i < runCount; ++i)
+    {
+        uint16_t mask;
+        uint32_t length;
+        ok = readU16(in, mask) && readVarint(in, length) && this->Inputs.size() + length <= ticks;
+        if (ok)
+            this->Inputs.insert(this->Inputs.end(), length, mask);
+    }
+    ok = ok && this->Inputs.size() == ticks;
+    this->Checksums.resize(ok ? ticks : 0);
+    for (uint32_t i = 0; ok && i < ticks; ++i)
+        ok = readU32(in, this->Checksums[i]);
+    if (!ok)
+        std::cout << "ERROR::REPLAY: " << file << " is truncated or corrupt" << std::endl;
+    return ok;
+}
+
+ReplayRecorder::ReplayRecorder(Game& game, unsigned int rate, uint32_t seed)
+    : game(game)
+{
+    game.Seed(seed);
+    this->Log.Rate = rate;
+    this->Log.Seed = seed;
+    this->Log.Initial = game.Checksum();
+}
+
+void ReplayRecorder::Step(float dt)
+{
+    this->Log.Inputs.push_back(CaptureInput(this->game));
+    this->game.Step(dt);
+    this->Log.Checksums.push_back(this->game.Checksum());
+}
+
+ReplayPlayer::ReplayPlayer(Game& game, const ReplayLog& log)
+    : game(game), log(log), dt(1.0f / (log.Rate > 0 ? log.Rate : 1)), tick(0), divergence(-1)
+{
+    game.Seed(log.Seed);
+    if (game.Checksum() != log.Initial)
+        this->divergence = 0;
+}
+
+bool ReplayPlayer::Step()
+{
+    if (this->Finished())
+        return false;
+    ApplyInput(this->game, this->log.Inputs[this->tick]);
+    this->game.Step(this->dt);
+    if (this->divergence < 0 && this->game.Checksum() != this->log.Checksums[this->tick])
+        this->divergence = this->tick + 1;
+    ++this->tick;
+    return true;
+}
+
+double ReplayPlayer::Run()
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while (this->Step())
+        this->game.EndFrame();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,95 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstdint>
+#include <vector>
+
+#include "game.h"
+
+
+// The keys the game reads; a tick's input is one bit per key for
+// Game::Keys followed by one bit per key for Game::KeysProcessed
+// (which the window's key callback clears on release).
+const int REPLAY_KEYS[] = { GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_SPACE, GLFW_KEY_ENTER, GLFW_KEY_W, GLFW_KEY_S };
+const unsigned int REPLAY_KEY_COUNT = sizeof(REPLAY_KEYS) / sizeof(REPLAY_KEYS[0]);
+
+// packs the input state of the game into a key mask
+uint16_t CaptureInput(const Game& game);
+// restores the input state of the game from a key mask
+void     ApplyInput(Game& game, uint16_t mask);
+
+
+// ReplayLog is everything needed to reproduce a session: the
+// simulation rate, the seed of the game's random streams and the key
+// mask of every tick, plus the state checksum after every tick to
+// detect where a replay diverges. On disk the masks are run-length
+// encoded, since input rarely changes from one tick to the next.
+class ReplayLog
+{
+public:
+    // session
+    unsigned int          Rate;      // ticks per second the session was recorded at
+    uint32_t              Seed;      // seed of the random generator at the start of the session
+    uint32_t              Initial;   // state checksum before the first tick
+    std::vector<uint16_t> Inputs;    // key mask per tick
+    std::vector<uint32_t> Checksums; // state checksum after each tick
+    // constructor
+    ReplayLog() : Rate(0), Seed(0), Initial(0) { }
+    // writes the log to a binary file; false on failure
+    bool Save(const char* file) const;
+    // reads a log written by Save; false on failure
+    bool Load(const char* file);
+};
+
+
+// ReplayRecorder captures the input of every tick of a game into
+// a ReplayLog. It steps the game itself so the input it records is
+// exactly what the tick saw.
+class ReplayRecorder
+{
+public:
+    ReplayLog Log;
+    // constructor; reseeds the game's random streams (the game must already be initialized)
+    ReplayRecorder(Game& game, unsigned int rate, uint32_t seed);
+    // records the current input, then steps the game by one tick
+    void Step(float dt);
+private:
+    Game& game;
+};
+
+
+// ReplayPlayer feeds a ReplayLog back into a game, one tick per
+// Step, and checks the state checksum after every tick. Input from
+// elsewhere is overwritten, so it works for a rendered game as well
+// as a headless one.
+class ReplayPlayer
+{
+public:
+    // constructor; reseeds the game's random streams (the game must already be initialized)
+    ReplayPlayer(Game& game, const ReplayLog& log);
+    // applies the next tick's input and steps the game; false once the log is exhausted
+    bool Step();
+    // plays the rest of the log as fast as possible; returns the wall-clock seconds spent
+    double Run();
+    // ticks played so far
+    unsigned int Tick() const { return this->tick; }
+    bool         Finished() const { return this->tick >= this->log.Inputs.size(); }
+    // first tick after which the state differed from the recording (0: already before the first tick), or -1
+    long long    FirstDivergence() const { return this->divergence; }
+private:
+    Game&            game;
+    const ReplayLog& log;
+    float            dt;
+    unsigned int     tick;
+    long long        divergence;
+};
+
+#endif
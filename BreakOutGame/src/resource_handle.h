@@ -0,0 +1,33 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef RESOURCE_HANDLE_H
+#define RESOURCE_HANDLE_H
+
+
+// A resource stored by the ResourceManager, as its index in the
+// manager's storage. Names are resolved to handles once, when a
+// resource is loaded or looked up; getting the resource back is then
+// a bounds-checked array access. The default (null) handle refers to
+// an empty resource, as does looking up a name nothing was loaded as.
+template <typename T>
+class ResourceHandle
+{
+public:
+    unsigned int Index;
+    // constructor
+    ResourceHandle() : Index(0) { }
+    explicit ResourceHandle(unsigned int index) : Index(index) { }
+};
+
+class Texture2D;
+class Shader;
+typedef ResourceHandle<Texture2D> TextureHandle;
+typedef ResourceHandle<Shader>    ShaderHandle;
+
+#endif
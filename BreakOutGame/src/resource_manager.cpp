@@ -8,46 +8,196 @@
 ******************************************************************/
 #include "resource_manager.h"
 
+#include <algorithm>
 #include <iostream>
-#include <sstream>
-#include <fstream>
+#include <vector>
 #include "stb_image.h"
 
+#include "cooked_texture.h"
+#include "file_system.h"
+
 // Instantiate static variables
-std::map<std::string, Texture2D>    ResourceManager::Textures;
-std::map<std::string, Shader>       ResourceManager::Shaders;
+std::vector<Texture2D>                  ResourceManager::Textures(1);
+std::vector<Shader>                     ResourceManager::Shaders(1);
+TextureAtlas                            ResourceManager::Atlas;
+std::atomic<unsigned int>               ResourceManager::NameLookups(0);
+std::map<std::string, ShaderHandle>     ResourceManager::shaderHandles;
+std::map<std::string, TextureHandle>    ResourceManager::textureHandles;
 
 
 Shader ResourceManager::LoadShader(const char* vShaderFile, const char* fShaderFile, const char* gShaderFile, std::string name)
 {
-    Shaders[name] = loadShaderFromFile(vShaderFile, fShaderFile, gShaderFile);
-    return Shaders[name];
+    Shader shader = loadShaderFromFile(vShaderFile, fShaderFile, gShaderFile);
+    storeShader(name, shader);
+    return shader;
+}
+
+Shader ResourceManager::LoadFeedbackShader(const char* vShaderFile, const std::vector<const char*>& varyings, std::string name)
+{
+    std::string vertexCode;
+    if (!FileSystem::ReadText(vShaderFile, vertexCode))
+        std::cout << "ERROR::SHADER: Failed to read shader files" << std::endl;
+    Shader shader;
+    shader.CompileFeedback(vertexCode.c_str(), varyings);
+    storeShader(name, shader);
+    return shader;
 }
 
-Shader ResourceManager::GetShader(std::string name)
+ShaderHandle ResourceManager::FindShader(const std::string& name)
 {
-    return Shaders[name];
+    // lookups never insert, so concurrent readers (e.g. headless games on worker threads) are safe
+    ++NameLookups;
+    std::map<std::string, ShaderHandle>::const_iterator it = shaderHandles.find(name);
+    return it != shaderHandles.end() ? it->second : ShaderHandle();
 }
 
 Texture2D ResourceManager::LoadTexture(const char* file, bool alpha, std::string name)
 {
-    Textures[name] = loadTextureFromFile(file, alpha);
-    return Textures[name];
+    PendingTexture texture = { file, name, alpha, false };
+    DecodeTexture(texture);
+    UploadTexture(texture);
+    return GetTexture(textureHandles[name]);
+}
+
+void ResourceManager::LoadAtlasTexture(const char* file, bool alpha, std::string name)
+{
+    PendingTexture texture = { file, name, alpha, true };
+    DecodeTexture(texture);
+    UploadTexture(texture);
+}
+
+// copies the first `channels` channels of every pixel into pixels of targetChannels, filling the rest with 255
+static void convertPixels(const unsigned char* source, int sourceChannels, size_t count, int channels, unsigned char* target, int targetChannels)
+{
+    int copied = std::min(sourceChannels, channels);
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::copy(source + i * sourceChannels, source + i * sourceChannels + copied, target + i * targetChannels);
+        std::fill(target + i * targetChannels + copied, target + (i + 1) * targetChannels, 255);
+    }
+}
+
+// whether the driver takes textures of a compressed format
+static bool supportsCompressedFormat(unsigned int format)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+    std::vector<GLint> formats(count);
+    if (count > 0)
+        glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats.data());
+    return std::find(formats.begin(), formats.end(), static_cast<GLint>(format)) != formats.end();
+}
+
+void ResourceManager::DecodeTexture(PendingTexture& texture)
+{
+    texture.Pixels.clear();
+    texture.Format = 0;
+    texture.Levels = 1;
+    if (decodeCookedTexture(texture))
+        return;
+    // the atlas is always RGBA; images without alpha are made opaque, as their GL_RGB texture would sample
+    int channels = texture.Alpha ? 4 : 3;
+    int nrChannels;
+    unsigned char* data = loadImage(texture.File.c_str(), &texture.Width, &texture.Height, &nrChannels, channels);
+    if (!data)
+    {
+        std::cout << "ERROR::TEXTURE: Failed to load " << texture.File << std::endl;
+        texture.Width = texture.Height = 0;
+        return;
+    }
+    int targetChannels = texture.Atlas ? 4 : channels;
+    size_t count = static_cast<size_t>(texture.Width) * texture.Height;
+    texture.Pixels.resize(count * targetChannels);
+    convertPixels(data, channels, count, channels, texture.Pixels.data(), targetChannels);
+    stbi_image_free(data);
+}
+
+void ResourceManager::UploadTexture(PendingTexture& texture)
+{
+    // without driver support compressed pixels are expanded here, which is still cheaper than decoding the source
+    if (texture.Format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT && !supportsCompressedFormat(texture.Format))
+        decompressTexture(texture);
+    if (texture.Atlas)
+    {
+        if (!texture.Pixels.empty())
+            Atlas.Add(texture.Name, texture.Width, texture.Height, texture.Pixels.data());
+    }
+    else
+    {
+        // create texture object
+        Texture2D generated;
+        if (texture.Format != 0)
+            generated.Internal_Format = texture.Format;
+        else if (texture.Alpha)
+        {
+            generated.Internal_Format = GL_RGBA;
+            generated.Image_Format = GL_RGBA;
+        }
+        generated.Levels = texture.Levels;
+        generated.Generate(texture.Width, texture.Height, texture.Pixels.empty() ? nullptr : texture.Pixels.data());
+        storeTexture(texture.Name, generated);
+    }
+    // and finally free image data
+    std::vector<unsigned char>().swap(texture.Pixels);
 }
 
-Texture2D ResourceManager::GetTexture(std::string name)
+void ResourceManager::BuildAtlas()
 {
-    return Textures[name];
+    std::map<std::string, Texture2D> regions;
+    Atlas.Build(regions);
+    for (const std::pair<const std::string, Texture2D>& region : regions)
+        storeTexture(region.first, region.second);
+}
+
+TextureHandle ResourceManager::FindTexture(const std::string& name)
+{
+    ++NameLookups;
+    std::map<std::string, TextureHandle>::const_iterator it = textureHandles.find(name);
+    return it != textureHandles.end() ? it->second : TextureHandle();
 }
 
 void ResourceManager::Clear()
 {
     // (properly) delete all shaders	
-    for (auto iter : Shaders)
-        glDeleteProgram(iter.second.ID);
-    // (properly) delete all textures
-    for (auto iter : Textures)
-        glDeleteTextures(1, &iter.second.ID);
+    for (const Shader& shader : Shaders)
+        if (shader.ID != 0)
+            glDeleteProgram(shader.ID);
+    // (properly) delete all textures; atlas regions share their page's texture object
+    for (const Texture2D& texture : Textures)
+        if (texture.ID != 0 && texture.OwnsTexture)
+            glDeleteTextures(1, &texture.ID);
+    for (const Texture2D& page : Atlas.Pages)
+        glDeleteTextures(1, &page.ID);
+    // handed-out handles now resolve to the empty resources
+    Shaders.assign(1, Shader());
+    Textures.assign(1, Texture2D());
+    shaderHandles.clear();
+    textureHandles.clear();
+    Atlas.Pages.clear();
+}
+
+void ResourceManager::storeShader(const std::string& name, const Shader& shader)
+{
+    std::map<std::string, ShaderHandle>::iterator it = shaderHandles.find(name);
+    if (it != shaderHandles.end())
+    {
+        Shaders[it->second.Index] = shader;
+        return;
+    }
+    shaderHandles[name] = ShaderHandle(static_cast<unsigned int>(Shaders.size()));
+    Shaders.push_back(shader);
+}
+
+void ResourceManager::storeTexture(const std::string& name, const Texture2D& texture)
+{
+    std::map<std::string, TextureHandle>::iterator it = textureHandles.find(name);
+    if (it != textureHandles.end())
+    {
+        Textures[it->second.Index] = texture;
+        return;
+    }
+    textureHandles[name] = TextureHandle(static_cast<unsigned int>(Textures.size()));
+    Textures.push_back(texture);
 }
 
 Shader ResourceManager::loadShaderFromFile(const char* vShaderFile, const char* fShaderFile, const char* gShaderFile)
@@ -56,38 +206,12 @@ Shader ResourceManager::loadShaderFromFile(const char* vShaderFile, const char*
     std::string vertexCode;
     std::string fragmentCode;
     std::string geometryCode;
-    try
-    {
-        // open files
-        std::ifstream vertexShaderFile(vShaderFile);
-        std::ifstream fragmentShaderFile(fShaderFile);
-        std::stringstream vShaderStream, fShaderStream;
-
-
-
-        // read file's buffer contents into streams
-        vShaderStream << vertexShaderFile.rdbuf();
-        fShaderStream << fragmentShaderFile.rdbuf();
-        // close file handlers
-        vertexShaderFile.close();
-        fragmentShaderFile.close();
-        // convert stream into string
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
-        // if geometry shader path is present, also load a geometry shader
-        if (gShaderFile != nullptr)
-        {
-            std::ifstream geometryShaderFile(gShaderFile);
-            std::stringstream gShaderStream;
-            gShaderStream << geometryShaderFile.rdbuf();
-            geometryShaderFile.close();
-            geometryCode = gShaderStream.str();
-        }
-    }
-    catch (std::exception e)
-    {
+    bool read = FileSystem::ReadText(vShaderFile, vertexCode) && FileSystem::ReadText(fShaderFile, fragmentCode);
+    // if geometry shader path is present, also load a geometry shader
+    if (gShaderFile != nullptr)
+        read = FileSystem::ReadText(gShaderFile, geometryCode) && read;
+    if (!read)
         std::cout << "ERROR::SHADER: Failed to read shader files" << std::endl;
-    }
     const char* vShaderCode = vertexCode.c_str();
     const char* fShaderCode = fragmentCode.c_str();
     const char* gShaderCode = geometryCode.c_str();
@@ -97,21 +221,78 @@ Shader ResourceManager::loadShaderFromFile(const char* vShaderFile, const char*
     return shader;
 }
 
-Texture2D ResourceManager::loadTextureFromFile(const char* file, bool alpha)
+bool ResourceManager::decodeCookedTexture(PendingTexture& texture)
 {
-    // create texture object
-    Texture2D texture;
-    if (alpha)
+    std::string path = CookedTexturePath(texture.File);
+    if (!FileSystem::Exists(path))
+        return false;
+    FileView file;
+    std::vector<char> storage;
+    CookedTexture cooked;
+    if (!FileSystem::ViewFile(path, file, storage) || !ParseCookedTexture(file, cooked))
     {
-        texture.Internal_Format = GL_RGBA;
-        texture.Image_Format = GL_RGBA;
+        std::cout << "ERROR::TEXTURE: " << path << " is not a cooked texture, decoding " << texture.File << " instead" << std::endl;
+        return false;
     }
-    // load image
-    int width, height, nrChannels;
-    unsigned char* data = stbi_load(file, &width, &height, &nrChannels, 0);
-    // now generate texture
-    texture.Generate(width, height, data);
-    // and finally free image data
-    stbi_image_free(data);
-    return texture;
+    // a file cooked from another version of the source is stale; without the source it is all there is
+    if (FileSystem::Exists(texture.File))
+    {
+        FileView source;
+        std::vector<char> sourceStorage;
+        if (FileSystem::ViewFile(texture.File, source, sourceStorage)
+            && (source.Size != cooked.SourceSize || CookedSourceHash(source) != cooked.SourceHash))
+        {
+            std::cout << "ERROR::TEXTURE: " << path << " is out of date, decoding " << texture.File << " instead" << std::endl;
+            return false;
+        }
+    }
+    texture.Width = cooked.Width;
+    texture.Height = cooked.Height;
+    int channels = texture.Alpha ? 4 : 3;
+    int storedChannels = cooked.Format == GL_RGBA ? 4 : 3;
+    // the common case: the cooked pixels are exactly what GL takes, so they are copied as they are, mip levels and all
+    if (!texture.Atlas && (cooked.Format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || storedChannels == channels))
+    {
+        if (cooked.Format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+            texture.Format = cooked.Format;
+        texture.Levels = cooked.Levels;
+        texture.Pixels.assign(cooked.Data, cooked.Data + cooked.Size);
+        return true;
+    }
+    texture.Pixels.assign(cooked.Data, cooked.Data + Texture2D::ImageSize(cooked.Format, cooked.Width, cooked.Height));
+    if (cooked.Format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+    {
+        texture.Format = cooked.Format;
+        decompressTexture(texture);
+        return true;
+    }
+    // otherwise only the top level is used, converted like a decoded source image would be
+    std::vector<unsigned char> stored;
+    stored.swap(texture.Pixels);
+    int targetChannels = texture.Atlas ? 4 : channels;
+    size_t count = static_cast<size_t>(texture.Width) * texture.Height;
+    texture.Pixels.resize(count * targetChannels);
+    convertPixels(stored.data(), storedChannels, count, channels, texture.Pixels.data(), targetChannels);
+    return true;
+}
+
+void ResourceManager::decompressTexture(PendingTexture& texture)
+{
+    size_t count = static_cast<size_t>(texture.Width) * texture.Height;
+    std::vector<unsigned char> rgb(count * 3);
+    DecompressBC1(texture.Pixels.data(), texture.Width, texture.Height, rgb.data());
+    int channels = texture.Alpha || texture.Atlas ? 4 : 3;
+    texture.Pixels.resize(count * channels);
+    convertPixels(rgb.data(), 3, count, 3, texture.Pixels.data(), channels);
+    texture.Format = 0;
+    texture.Levels = 1;
+}
+
+unsigned char* ResourceManager::loadImage(const char* file, int* width, int* height, int* channels, int desiredChannels)
+{
+    FileView encoded;
+    std::vector<char> storage;
+    if (!FileSystem::ViewFile(file, encoded, storage))
+        return nullptr;
+    return stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(encoded.Data), static_cast<int>(encoded.Size), width, height, channels, desiredChannels);
 }
\ No newline at end of file
@@ -9,43 +9,97 @@
 #ifndef RESOURCE_MANAGER_H
 #define RESOURCE_MANAGER_H
 
+#include <atomic>
 #include <map>
 #include <string>
+#include <vector>
 
 #include <glad/glad.h>
 
 #include "texture.h"
+#include "texture_atlas.h"
 #include "shader.h"
+#include "resource_handle.h"
+
+
+// A texture file on its way in: decoded by DecodeTexture on any thread,
+// then handed to GL (or the atlas) by UploadTexture on the GL thread.
+// A cooked version of the file (see cooked_texture.h) is used instead
+// of the source image when the file system has one.
+struct PendingTexture {
+    std::string                File;
+    std::string                Name;
+    bool                       Alpha;
+    bool                       Atlas;  // goes into the atlas rather than a texture of its own
+    int                        Width, Height;
+    unsigned int               Format; // compressed GL format of Pixels when cooked that way, 0 for plain pixels
+    unsigned int               Levels; // mip levels in Pixels
+    std::vector<unsigned char> Pixels; // empty if decoding failed
+    // constructor
+    PendingTexture(const std::string& file, const std::string& name, bool alpha, bool atlas)
+        : File(file), Name(name), Alpha(alpha), Atlas(atlas), Width(0), Height(0), Format(0), Levels(1) { }
+};
 
 
 // A static singleton ResourceManager class that hosts several
 // functions to load Textures and Shaders. Each loaded texture
-// and/or shader is also stored for future reference by string
-// handles. All functions and resources are static and no 
-// public constructor is defined.
+// and/or shader is also stored for future reference under its
+// name, which is interned into an integer handle: look names up
+// once with FindTexture/FindShader and keep the handle. All
+// functions and resources are static and no public constructor
+// is defined. Files are logical paths read through the FileSystem.
 class ResourceManager
 {
 public:
-    // resource storage
-    static std::map<std::string, Shader>    Shaders;
-    static std::map<std::string, Texture2D> Textures;
+    // resource storage, indexed by handle; index 0 holds the empty resource of the null handle
+    static std::vector<Shader>       Shaders;
+    static std::vector<Texture2D>    Textures;
+    static TextureAtlas              Atlas;
+    // lookups by name so far; these are map searches, so they should stay out of per-frame code
+    static std::atomic<unsigned int> NameLookups;
     // loads (and generates) a shader program from file loading vertex, fragment (and geometry) shader's source code. If gShaderFile is not nullptr, it also loads a geometry shader
     static Shader    LoadShader(const char* vShaderFile, const char* fShaderFile, const char* gShaderFile, std::string name);
-    // retrieves a stored sader
-    static Shader    GetShader(std::string name);
+    // loads (and generates) a vertex-only transform feedback program from file, capturing the given outputs
+    static Shader    LoadFeedbackShader(const char* vShaderFile, const std::vector<const char*>& varyings, std::string name);
+    // resolves a shader's name to its handle; the null handle if there is no such shader
+    static ShaderHandle FindShader(const std::string& name);
+    // retrieves a stored shader
+    static const Shader& GetShader(ShaderHandle handle) { return Shaders[handle.Index < Shaders.size() ? handle.Index : 0]; }
+    static const Shader& GetShader(const std::string& name) { return GetShader(FindShader(name)); }
     // loads (and generates) a texture from file
     static Texture2D LoadTexture(const char* file, bool alpha, std::string name);
+    // loads a texture from file into the atlas; it can be retrieved once BuildAtlas has run
+    static void      LoadAtlasTexture(const char* file, bool alpha, std::string name);
+    // decodes a pending texture's file; needs no GL context, so it can run on any thread
+    static void      DecodeTexture(PendingTexture& texture);
+    // stores a decoded texture like LoadTexture or LoadAtlasTexture would; frees its pixels
+    static void      UploadTexture(PendingTexture& texture);
+    // packs the textures loaded into the atlas since the last call into atlas pages
+    static void      BuildAtlas();
+    // resolves a texture's name to its handle; the null handle if there is no such texture
+    static TextureHandle FindTexture(const std::string& name);
     // retrieves a stored texture
-    static Texture2D GetTexture(std::string name);
+    static const Texture2D& GetTexture(TextureHandle handle) { return Textures[handle.Index < Textures.size() ? handle.Index : 0]; }
+    static const Texture2D& GetTexture(const std::string& name) { return GetTexture(FindTexture(name)); }
     // properly de-allocates all loaded resources
     static void      Clear();
 private:
     // private constructor, that is we do not want any actual resource manager objects. Its members and functions should be publicly available (static).
     ResourceManager() { }
+    // handles by name; only written while loading
+    static std::map<std::string, ShaderHandle>  shaderHandles;
+    static std::map<std::string, TextureHandle> textureHandles;
+    // store a resource under a name, replacing what was stored under it before
+    static void      storeShader(const std::string& name, const Shader& shader);
+    static void      storeTexture(const std::string& name, const Texture2D& texture);
     // loads and generates a shader from file
     static Shader    loadShaderFromFile(const char* vShaderFile, const char* fShaderFile, const char* gShaderFile = nullptr);
-    // loads a single texture from file
-    static Texture2D loadTextureFromFile(const char* file, bool alpha);
+    // fills a pending texture from the file's cooked version; false if there is none
+    static bool      decodeCookedTexture(PendingTexture& texture);
+    // expands a pending texture's BC1 pixels to the plain pixels it would have been decoded to
+    static void      decompressTexture(PendingTexture& texture);
+    // decodes an image file viewed through the FileSystem; free the result with stbi_image_free
+    static unsigned char* loadImage(const char* file, int* width, int* height, int* channels, int desiredChannels);
 };
 
 #endif
\ No newline at end of file
@@ -7,8 +7,61 @@
 ** option) any later version.
 ******************************************************************/
 #include "shader.h"
+#include "frame_uniforms.h"
 
 #include <iostream>
+#include <vector>
+
+
+// integer uniforms also take bools and sampler units
+static bool assignable(GLenum declared, GLenum requested)
+{
+    if (declared == requested)
+        return true;
+    if (requested != GL_INT)
+        return false;
+    switch (declared)
+    {
+    case GL_BOOL:
+    case GL_SAMPLER_1D:
+    case GL_SAMPLER_2D:
+    case GL_SAMPLER_3D:
+    case GL_SAMPLER_CUBE:
+    case GL_SAMPLER_2D_ARRAY:
+    case GL_SAMPLER_2D_MULTISAMPLE:
+    case GL_SAMPLER_BUFFER:
+    case GL_INT_SAMPLER_2D:
+    case GL_UNSIGNED_INT_SAMPLER_2D:
+        return true;
+    default:
+        return false;
+    }
+}
+
+template <> void Uniform<float>::Set(const float& value) const
+{
+    glUniform1f(this->Location, value);
+}
+template <> void Uniform<int>::Set(const int& value) const
+{
+    glUniform1i(this->Location, value);
+}
+template <> void Uniform<glm::vec2>::Set(const glm::vec2& value) const
+{
+    glUniform2f(this->Location, value.x, value.y);
+}
+template <> void Uniform<glm::vec3>::Set(const glm::vec3& value) const
+{
+    glUniform3f(this->Location, value.x, value.y, value.z);
+}
+template <> void Uniform<glm::vec4>::Set(const glm::vec4& value) const
+{
+    glUniform4f(this->Location, value.x, value.y, value.z, value.w);
+}
+template <> void Uniform<glm::mat4>::Set(const glm::mat4& value) const
+{
+    glUniformMatrix4fv(this->Location, 1, false, glm::value_ptr(value));
+}
 
 Shader& Shader::Use()
 {
@@ -45,6 +98,7 @@ void Shader::Compile(const char* vertexSource, const char* fragmentSource, const
         glAttachShader(this->ID, gShader);
     glLinkProgram(this->ID);
     checkCompileErrors(this->ID, "PROGRAM");
+    this->configureProgram();
     // delete the shaders as they're linked into our program now and no longer necessary
     glDeleteShader(sVertex);
     glDeleteShader(sFragment);
@@ -52,61 +106,139 @@ void Shader::Compile(const char* vertexSource, const char* fragmentSource, const
         glDeleteShader(gShader);
 }
 
+void Shader::CompileFeedback(const char* vertexSource, const std::vector<const char*>& varyings)
+{
+    unsigned int sVertex = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(sVertex, 1, &vertexSource, NULL);
+    glCompileShader(sVertex);
+    checkCompileErrors(sVertex, "VERTEX");
+    this->ID = glCreateProgram();
+    glAttachShader(this->ID, sVertex);
+    // the captured outputs have to be named before linking
+    glTransformFeedbackVaryings(this->ID, static_cast<GLsizei>(varyings.size()), varyings.data(), GL_INTERLEAVED_ATTRIBS);
+    glLinkProgram(this->ID);
+    checkCompileErrors(this->ID, "PROGRAM");
+    this->configureProgram();
+    glDeleteShader(sVertex);
+}
+
 void Shader::SetFloat(const char* name, float value, bool useShader)
 {
     if (useShader)
         this->Use();
-    glUniform1f(glGetUniformLocation(this->ID, name), value);
+    glUniform1f(this->location(name, GL_FLOAT), value);
 }
 void Shader::SetInteger(const char* name, int value, bool useShader)
 {
     if (useShader)
         this->Use();
-    glUniform1i(glGetUniformLocation(this->ID, name), value);
+    glUniform1i(this->location(name, GL_INT), value);
 }
 void Shader::SetVector2f(const char* name, float x, float y, bool useShader)
 {
     if (useShader)
         this->Use();
-    glUniform2f(glGetUniformLocation(this->ID, name), x, y);
+    glUniform2f(this->location(name, GL_FLOAT_VEC2), x, y);
 }
 void Shader::SetVector2f(const char* name, const glm::vec2& value, bool useShader)
 {
     if (useShader)
         this->Use();
-    glUniform2f(glGetUniformLocation(this->ID, name), value.x, value.y);
+    glUniform2f(this->location(name, GL_FLOAT_VEC2), value.x, value.y);
 }
 void Shader::SetVector3f(const char* name, float x, float y, float z, bool useShader)
 {
     if (useShader)
         this->Use();
-    glUniform3f(glGetUniformLocation(this->ID, name), x, y, z);
+    glUniform3f(this->location(name, GL_FLOAT_VEC3), x, y, z);
 }
 void Shader::SetVector3f(const char* name, const glm::vec3& value, bool useShader)
 {
     if (useShader)
         this->Use();
-    glUniform3f(glGetUniformLocation(this->ID, name), value.x, value.y, value.z);
+    glUniform3f(this->location(name, GL_FLOAT_VEC3), value.x, value.y, value.z);
 }
 void Shader::SetVector4f(const char* name, float x, float y, float z, float w, bool useShader)
 {
     if (useShader)
         this->Use();
-    glUniform4f(glGetUniformLocation(this->ID, name), x, y, z, w);
+    glUniform4f(this->location(name, GL_FLOAT_VEC4), x, y, z, w);
 }
 void Shader::SetVector4f(const char* name, const glm::vec4& value, bool useShader)
 {
     if (useShader)
         this->Use();
-    glUniform4f(glGetUniformLocation(this->ID, name), value.x, value.y, value.z, value.w);
+    glUniform4f(this->location(name, GL_FLOAT_VEC4), value.x, value.y, value.z, value.w);
 }
 void Shader::SetMatrix4(const char* name, const glm::mat4& matrix, bool useShader)
 {
     if (useShader)
         this->Use();
-    glUniformMatrix4fv(glGetUniformLocation(this->ID, name), 1, false, glm::value_ptr(matrix));
+    glUniformMatrix4fv(this->location(name, GL_FLOAT_MAT4), 1, false, glm::value_ptr(matrix));
+}
+
+int Shader::location(const char* name, GLenum type) const
+{
+    if (!this->uniforms)
+        return -1;
+    std::map<std::string, ShaderUniform>::const_iterator it = this->uniforms->Active.find(name);
+    if (it != this->uniforms->Active.end() && assignable(it->second.Type, type))
+        return it->second.Location;
+#ifndef NDEBUG
+    // report every name once, not on every frame it is set
+    if (this->uniforms->Missing.insert(name).second)
+    {
+        if (it == this->uniforms->Active.end())
+            std::cout << "ERROR::SHADER: Uniform " << name << " is not active in program " << this->ID << " (misspelled, or optimized out)" << std::endl;
+        else
+            std::cout << "ERROR::SHADER: Uniform " << name << " of program " << this->ID << " is set with the wrong type" << std::endl;
+    }
+#endif
+    return -1;
 }
 
+void Shader::configureProgram()
+{
+    // frame-global data comes from the shared uniform buffer
+    unsigned int frameBlock = glGetUniformBlockIndex(this->ID, FRAME_DATA_BLOCK);
+    if (frameBlock != GL_INVALID_INDEX)
+        glUniformBlockBinding(this->ID, frameBlock, FRAME_DATA_BINDING);
+    this->reflectUniforms();
+}
+
+void Shader::reflectUniforms()
+{
+    this->uniforms = std::make_shared<ShaderUniforms>();
+    int count = 0, maxLength = 0;
+    glGetProgramiv(this->ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(this->ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<char> buffer(maxLength + 1);
+    for (int i = 0; i < count; ++i)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(this->ID, i, static_cast<GLsizei>(buffer.size()), &length, &size, &type, buffer.data());
+        std::string name(buffer.data(), length);
+        int location = glGetUniformLocation(this->ID, name.c_str());
+        if (location < 0)
+            continue; // member of a uniform block
+        // arrays are reported once, as name[0]; list the bare name and every element
+        std::string::size_type bracket = name.rfind("[0]");
+        if (bracket == std::string::npos || bracket + 3 != name.size())
+        {
+            this->uniforms->Active[name] = { location, type };
+            continue;
+        }
+        std::string base = name.substr(0, bracket);
+        this->uniforms->Active[base] = { location, type };
+        for (int element = 0; element < size; ++element)
+        {
+            std::string elementName = base + "[" + std::to_string(element) + "]";
+            this->uniforms->Active[elementName] = { glGetUniformLocation(this->ID, elementName.c_str()), type };
+        }
+    }
+}
 
 void Shader::checkCompileErrors(unsigned int object, std::string type)
 {
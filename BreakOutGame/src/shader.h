@@ -9,27 +9,81 @@
 #ifndef SHADER_H
 #define SHADER_H
 
+#include <map>
+#include <memory>
+#include <set>
 #include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 
+// GL type of the uniforms a C++ type can be assigned to
+template <typename T> struct UniformType;
+template <> struct UniformType<float>     { static const GLenum Value = GL_FLOAT; };
+template <> struct UniformType<int>       { static const GLenum Value = GL_INT; };
+template <> struct UniformType<glm::vec2> { static const GLenum Value = GL_FLOAT_VEC2; };
+template <> struct UniformType<glm::vec3> { static const GLenum Value = GL_FLOAT_VEC3; };
+template <> struct UniformType<glm::vec4> { static const GLenum Value = GL_FLOAT_VEC4; };
+template <> struct UniformType<glm::mat4> { static const GLenum Value = GL_FLOAT_MAT4; };
+
+// A uniform of a shader program, resolved once by Shader::GetUniform.
+// Setting it is a single glUniform call on the stored location; like
+// glUniform, it applies to the program currently in use. Handles of
+// uniforms the program doesn't have are inert.
+template <typename T>
+class Uniform
+{
+public:
+    int Location;
+    // constructor
+    Uniform() : Location(-1) { }
+    explicit Uniform(int location) : Location(location) { }
+    // sets the uniform of the active program
+    void Set(const T& value) const;
+};
+
+template <> void Uniform<float>::Set(const float& value) const;
+template <> void Uniform<int>::Set(const int& value) const;
+template <> void Uniform<glm::vec2>::Set(const glm::vec2& value) const;
+template <> void Uniform<glm::vec3>::Set(const glm::vec3& value) const;
+template <> void Uniform<glm::vec4>::Set(const glm::vec4& value) const;
+template <> void Uniform<glm::mat4>::Set(const glm::mat4& value) const;
+
+// An active uniform of a linked program, as reported by glGetActiveUniform
+struct ShaderUniform {
+    int    Location;
+    GLenum Type;
+};
+
+// The uniforms of a linked program, shared by all copies of its Shader
+struct ShaderUniforms {
+    std::map<std::string, ShaderUniform> Active; // by name; array elements are listed as name[i]
+    std::set<std::string>                Missing; // names already reported as not active
+};
+
+
 // General purpose shader object. Compiles from file, generates
 // compile/link-time error messages and hosts several utility 
-// functions for easy management.
+// functions for easy management. After linking, the program's
+// active uniforms are reflected into a table once, so setting a
+// uniform never asks GL for its location; for per-frame or per-draw
+// uniforms, GetUniform returns a handle that skips the table too.
 class Shader
 {
 public:
     // state
     unsigned int ID;
     // constructor
-    Shader() { }
+    Shader() : ID(0) { }
     // sets the current shader as active
     Shader& Use();
     // compiles the shader from given source code
     void    Compile(const char* vertexSource, const char* fragmentSource, const char* geometrySource = nullptr); // note: geometry source code is optional 
+    // compiles a vertex-only program whose outputs are captured with transform feedback, interleaved in the order given
+    void    CompileFeedback(const char* vertexSource, const std::vector<const char*>& varyings);
     // utility functions
     void    SetFloat(const char* name, float value, bool useShader = false);
     void    SetInteger(const char* name, int value, bool useShader = false);
@@ -40,7 +94,18 @@ public:
     void    SetVector4f(const char* name, float x, float y, float z, float w, bool useShader = false);
     void    SetVector4f(const char* name, const glm::vec4& value, bool useShader = false);
     void    SetMatrix4(const char* name, const glm::mat4& matrix, bool useShader = false);
+    // resolves a uniform by name; an inert handle if the program has no such uniform of type T
+    template <typename T>
+    Uniform<T> GetUniform(const char* name) const { return Uniform<T>(this->location(name, UniformType<T>::Value)); }
 private:
+    // active uniforms of the program, filled in by Compile
+    std::shared_ptr<ShaderUniforms> uniforms;
+    // looks a uniform up in the reflected table, -1 if it isn't there; debug builds report missing uniforms and type mismatches
+    int     location(const char* name, GLenum type) const;
+    // binds the frame data block and reflects the uniforms of the freshly linked program
+    void    configureProgram();
+    // fills the uniform table from the linked program
+    void    reflectUniforms();
     // checks if compilation or linking failed and if so, print the error logs
     void    checkCompileErrors(unsigned int object, std::string type);
 };
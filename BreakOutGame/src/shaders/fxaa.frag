@@ -0,0 +1,52 @@
+#version 330 core
+in  vec2  TexCoords;
+out vec4  color;
+
+uniform sampler2D scene;
+uniform vec2      texelSize; // 1 / scene size
+
+// FXAA (after Timothy Lottes' FXAA 3.11, console variant): blurs along
+// the local edge direction, found from the luma of the four diagonal
+// neighbours, and skips pixels without enough contrast.
+const float EDGE_THRESHOLD     = 1.0 / 8.0;
+const float EDGE_THRESHOLD_MIN = 1.0 / 24.0;
+const float REDUCE_MUL         = 1.0 / 8.0;
+const float REDUCE_MIN         = 1.0 / 128.0;
+const float SPAN_MAX           = 8.0;
+
+float luma(vec3 rgb)
+{
+    return dot(rgb, vec3(0.299, 0.587, 0.114));
+}
+
+void main()
+{
+    vec3 rgbM  = texture(scene, TexCoords).rgb;
+    float lumaM  = luma(rgbM);
+    float lumaNW = luma(texture(scene, TexCoords + vec2(-1.0, -1.0) * texelSize).rgb);
+    float lumaNE = luma(texture(scene, TexCoords + vec2( 1.0, -1.0) * texelSize).rgb);
+    float lumaSW = luma(texture(scene, TexCoords + vec2(-1.0,  1.0) * texelSize).rgb);
+    float lumaSE = luma(texture(scene, TexCoords + vec2( 1.0,  1.0) * texelSize).rgb);
+    float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+    float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+    // flat areas keep their pixel
+    if (lumaMax - lumaMin < max(EDGE_THRESHOLD_MIN, lumaMax * EDGE_THRESHOLD))
+    {
+        color = vec4(rgbM, 1.0);
+        return;
+    }
+
+    // direction along the edge, scaled so its smaller component is about one texel
+    vec2 dir = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));
+    float dirReduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.25 * REDUCE_MUL, REDUCE_MIN);
+    float rcpDirMin = 1.0 / (min(abs(dir.x), abs(dir.y)) + dirReduce);
+    dir = clamp(dir * rcpDirMin, vec2(-SPAN_MAX), vec2(SPAN_MAX)) * texelSize;
+
+    // two taps close along the edge, and two more further out unless they cross into another edge
+    vec3 rgbA = 0.5 * (texture(scene, TexCoords + dir * (1.0 / 3.0 - 0.5)).rgb
+                     + texture(scene, TexCoords + dir * (2.0 / 3.0 - 0.5)).rgb);
+    vec3 rgbB = rgbA * 0.5 + 0.25 * (texture(scene, TexCoords - dir * 0.5).rgb
+                                   + texture(scene, TexCoords + dir * 0.5).rgb);
+    float lumaB = luma(rgbB);
+    color = vec4((lumaB < lumaMin || lumaB > lumaMax) ? rgbA : rgbB, 1.0);
+}
@@ -1,12 +1,19 @@
 #version 330 core
 layout (location = 0) in vec4 vertex; // <vec2 position, vec2 texCoords>
+layout (location = 1) in vec2 offset; // per particle
+layout (location = 2) in vec4 color;  // per particle
+layout (location = 3) in float life;  // per particle
 
 out vec2 TexCoords;
 out vec4 ParticleColor;
 
-uniform mat4 projection;
-uniform vec2 offset;
-uniform vec4 color;
+layout (std140) uniform FrameData {
+    mat4  projection;
+    float time;
+    bool  confuse;
+    bool  chaos;
+    bool  shake;
+};
 
 void main()
 {
@@ -14,4 +21,7 @@ void main()
     TexCoords = vertex.zw;
     ParticleColor = color;
     gl_Position = projection * vec4((vertex.xy * scale) + offset, 0.0, 1.0);
+    // dead particles are only drawn by the GPU simulation, which draws every slot; clip them away
+    if (life <= 0.0)
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,27 @@
+#version 330 core
+// advances one particle by dt; the outputs are captured with transform feedback
+layout (location = 0) in vec2 position;
+layout (location = 1) in vec2 velocity;
+layout (location = 2) in vec4 color;
+layout (location = 3) in float life;
+
+out vec2 outPosition;
+out vec2 outVelocity;
+out vec4 outColor;
+out float outLife;
+
+uniform float dt;
+
+void main()
+{
+    // same steps as ParticleGenerator::Update on the CPU
+    outPosition = position;
+    outVelocity = velocity;
+    outColor = color;
+    outLife = life - dt;
+    if (outLife > 0.0)
+    {
+        outPosition = position - velocity * dt;
+        outColor.a = color.a - dt * 2.5;
+    }
+}
@@ -1,13 +1,35 @@
 #version 330 core
-layout (location = 0) in vec4 vertex; // <vec2 position, vec2 texCoords>
+layout (location = 0) in vec4 vertex;     // <vec2 position, vec2 texCoords>
+layout (location = 1) in vec4 placement;  // per sprite: <vec2 position, vec2 size>
+layout (location = 2) in vec4 appearance; // per sprite: <vec3 color, float rotation (radians)>
+layout (location = 3) in int textureSlot; // per sprite
+layout (location = 4) in vec4 region;     // per sprite: <vec2 uv0, vec2 uv1> of the image within its texture
+layout (location = 5) in int visible;     // per sprite: 0 for sprites hidden in a SpriteBuffer
 
 out vec2 TexCoords;
+out vec3 SpriteColor;
+flat out int TextureSlot;
 
-uniform mat4 model;
-uniform mat4 projection;
+layout (std140) uniform FrameData {
+    mat4  projection;
+    float time;
+    bool  confuse;
+    bool  chaos;
+    bool  shake;
+};
 
 void main()
 {
-    TexCoords = vertex.zw;
-    gl_Position = projection * model * vec4(vertex.xy, 0.0, 1.0);
-}
\ No newline at end of file
+    TexCoords = mix(region.xy, region.zw, vertex.zw);
+    SpriteColor = appearance.rgb;
+    TextureSlot = textureSlot;
+    // scale, rotate around the center of the quad, then translate
+    vec2 size = placement.zw;
+    vec2 local = (vertex.xy - 0.5) * size;
+    float s = sin(appearance.a);
+    float c = cos(appearance.a);
+    vec2 rotated = vec2(c * local.x - s * local.y, s * local.x + c * local.y);
+    gl_Position = projection * vec4(placement.xy + 0.5 * size + rotated, 0.0, 1.0);
+    if (visible == 0)
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0); // outside the clip volume
+}
@@ -2,7 +2,13 @@
 layout (location = 0) in vec4 vertex; // <vec2 pos, vec2 tex>
 out vec2 TexCoords;
 
-uniform mat4 projection;
+layout (std140) uniform FrameData {
+    mat4  projection;
+    float time;
+    bool  confuse;
+    bool  chaos;
+    bool  shake;
+};
 
 void main()
 {
@@ -8,48 +8,201 @@
 ******************************************************************/
 #include "sprite_renderer.h"
 
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+
+// fills in everything but the texture slot
+static SpriteInstance makeInstance(const Texture2D& texture, glm::vec2 position, glm::vec2 size, float rotate, glm::vec3 color)
+{
+    SpriteInstance instance;
+    instance.Position = position;
+    instance.Size = size;
+    instance.Color = color;
+    instance.Rotation = glm::radians(rotate);
+    instance.Region = texture.Region;
+    instance.Texture = 0;
+    instance.Visible = 1;
+    return instance;
+}
+
+// binds each texture to its own unit, as the slots of the instances refer to them
+static void bindTextures(const unsigned int* textures, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
+
+SpriteBuffer::SpriteBuffer()
+    : textureCount(0), visibleCount(0), VAO(0), instanceVBO(0)
+{
+
+}
+
+SpriteBuffer::~SpriteBuffer()
+{
+    glDeleteVertexArrays(1, &this->VAO);
+    glDeleteBuffers(1, &this->instanceVBO);
+}
+
+void SpriteBuffer::Clear()
+{
+    this->sprites.clear();
+    this->textureCount = 0;
+    this->visibleCount = 0;
+}
+
+unsigned int SpriteBuffer::Add(const Texture2D& texture, glm::vec2 position, glm::vec2 size, float rotate, glm::vec3 color, bool visible)
+{
+    SpriteInstance instance = makeInstance(texture, position, size, rotate, color);
+    unsigned int slot = 0;
+    while (slot < this->textureCount && this->textures[slot] != texture.ID)
+        ++slot;
+    if (slot == this->textureCount)
+    {
+        if (this->textureCount < MAX_BATCH_TEXTURES)
+            this->textures[this->textureCount++] = texture.ID;
+        else
+        {
+            std::cout << "ERROR::SPRITEBUFFER: More than " << MAX_BATCH_TEXTURES << " textures in one buffer" << std::endl;
+            slot = 0;
+        }
+    }
+    instance.Texture = static_cast<int>(slot);
+    instance.Visible = visible ? 1 : 0;
+    this->visibleCount += visible ? 1 : 0;
+    this->sprites.push_back(instance);
+    return static_cast<unsigned int>(this->sprites.size() - 1);
+}
+
+void SpriteBuffer::SetVisible(unsigned int index, bool visible)
+{
+    SpriteInstance& sprite = this->sprites[index];
+    if ((sprite.Visible != 0) == visible)
+        return;
+    sprite.Visible = visible ? 1 : 0;
+    this->visibleCount += visible ? 1 : -1;
+    if (this->instanceVBO == 0)
+        return;
+    glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+    glBufferSubData(GL_ARRAY_BUFFER, index * sizeof(SpriteInstance) + offsetof(SpriteInstance, Visible), sizeof(sprite.Visible), &sprite.Visible);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
 
 SpriteRenderer::SpriteRenderer(Shader& shader)
+    : DrawCalls(0), Sprites(0), batching(false), textureCount(0)
 {
     this->shader = shader;
+    // every texture slot of a batch samples from its own texture unit
+    this->shader.Use();
+    for (unsigned int i = 0; i < MAX_BATCH_TEXTURES; ++i)
+        this->shader.SetInteger(("images[" + std::to_string(i) + "]").c_str(), i);
+    this->instances.reserve(MAX_BATCH_SPRITES);
     this->initRenderData();
 }
 
 SpriteRenderer::~SpriteRenderer()
 {
     glDeleteVertexArrays(1, &this->quadVAO);
+    glDeleteBuffers(1, &this->quadVBO);
+    glDeleteBuffers(1, &this->instanceVBO);
 }
 
-void SpriteRenderer::DrawSprite(Texture2D& texture, glm::vec2 position, glm::vec2 size, float rotate, glm::vec3 color)
+void SpriteRenderer::Begin()
 {
-    // prepare transformations
-    this->shader.Use();
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(position, 0.0f));  // first translate (transformations are: scale happens first, then rotation, and then final translation happens; reversed order)
+    this->batching = true;
+}
 
-    model = glm::translate(model, glm::vec3(0.5f * size.x, 0.5f * size.y, 0.0f)); // move origin of rotation to center of quad
-    model = glm::rotate(model, glm::radians(rotate), glm::vec3(0.0f, 0.0f, 1.0f)); // then rotate
-    model = glm::translate(model, glm::vec3(-0.5f * size.x, -0.5f * size.y, 0.0f)); // move origin back
+void SpriteRenderer::Submit(const Texture2D& texture, glm::vec2 position, glm::vec2 size, float rotate, glm::vec3 color)
+{
+    SpriteInstance instance = makeInstance(texture, position, size, rotate, color);
+    // find the texture's slot in this batch, starting a new batch once all slots are taken
+    unsigned int slot = 0;
+    while (slot < this->textureCount && this->textures[slot] != texture.ID)
+        ++slot;
+    if (slot == this->textureCount)
+    {
+        if (this->textureCount == MAX_BATCH_TEXTURES)
+        {
+            this->drawBatch();
+            slot = 0;
+        }
+        this->textures[this->textureCount++] = texture.ID;
+    }
 
-    model = glm::scale(model, glm::vec3(size, 1.0f)); // last scale
+    instance.Texture = static_cast<int>(slot);
+    this->instances.push_back(instance);
 
-    this->shader.SetMatrix4("model", model);
+    if (!this->batching || this->instances.size() == MAX_BATCH_SPRITES)
+        this->drawBatch();
+}
 
-    // render textured quad
-    this->shader.SetVector3f("spriteColor", color);
+void SpriteRenderer::Flush()
+{
+    this->drawBatch();
+    this->batching = false;
+}
 
-    glActiveTexture(GL_TEXTURE0);
-    texture.Bind();
+void SpriteRenderer::drawBatch()
+{
+    if (this->instances.empty())
+        return;
+    this->shader.Use();
+    bindTextures(this->textures, this->textureCount);
+
+    // orphan the previous contents so the driver doesn't have to wait for the last draw to finish reading them
+    glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, MAX_BATCH_SPRITES * sizeof(SpriteInstance), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, this->instances.size() * sizeof(SpriteInstance), this->instances.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     glBindVertexArray(this->quadVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, static_cast<GLsizei>(this->instances.size()));
     glBindVertexArray(0);
+
+    ++this->DrawCalls;
+    this->Sprites += static_cast<unsigned int>(this->instances.size());
+    this->instances.clear();
+    this->textureCount = 0;
+}
+
+void SpriteRenderer::Upload(SpriteBuffer& buffer)
+{
+    if (buffer.VAO == 0)
+    {
+        glGenVertexArrays(1, &buffer.VAO);
+        glGenBuffers(1, &buffer.instanceVBO);
+        this->initVertexArray(buffer.VAO, buffer.instanceVBO);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, buffer.instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, buffer.sprites.size() * sizeof(SpriteInstance), buffer.sprites.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void SpriteRenderer::Draw(const SpriteBuffer& buffer)
+{
+    // keep the submission order: whatever was queued before the buffer is drawn under it
+    this->drawBatch();
+    if (buffer.VAO == 0 || buffer.sprites.empty())
+        return;
+    this->shader.Use();
+    bindTextures(buffer.textures, buffer.textureCount);
+    glBindVertexArray(buffer.VAO);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, static_cast<GLsizei>(buffer.sprites.size()));
+    glBindVertexArray(0);
+    ++this->DrawCalls;
+    this->Sprites += buffer.visibleCount;
 }
 
 void SpriteRenderer::initRenderData()
 {
     // configure VAO/VBO
-    unsigned int VBO;
     float vertices[] = {
         // pos      // tex
         0.0f, 1.0f, 0.0f, 1.0f,
@@ -62,14 +215,42 @@ void SpriteRenderer::initRenderData()
     };
 
     glGenVertexArrays(1, &this->quadVAO);
-    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &this->quadVBO);
+    glGenBuffers(1, &this->instanceVBO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->quadVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
-    glBindVertexArray(this->quadVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, MAX_BATCH_SPRITES * sizeof(SpriteInstance), nullptr, GL_STREAM_DRAW);
+    this->initVertexArray(this->quadVAO, this->instanceVBO);
+}
+
+void SpriteRenderer::initVertexArray(unsigned int VAO, unsigned int instanceBuffer)
+{
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->quadVBO);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+
+    // per-sprite attributes advance once per instance
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glEnableVertexAttribArray(1); // position, size
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)offsetof(SpriteInstance, Position));
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(2); // color, rotation
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)offsetof(SpriteInstance, Color));
+    glVertexAttribDivisor(2, 1);
+    glEnableVertexAttribArray(4); // texture region
+    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)offsetof(SpriteInstance, Region));
+    glVertexAttribDivisor(4, 1);
+    glEnableVertexAttribArray(3); // texture slot
+    glVertexAttribIPointer(3, 1, GL_INT, sizeof(SpriteInstance), (void*)offsetof(SpriteInstance, Texture));
+    glVertexAttribDivisor(3, 1);
+    glEnableVertexAttribArray(5); // visibility
+    glVertexAttribIPointer(5, 1, GL_INT, sizeof(SpriteInstance), (void*)offsetof(SpriteInstance, Visible));
+    glVertexAttribDivisor(5, 1);
+
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
-}
\ No newline at end of file
+}
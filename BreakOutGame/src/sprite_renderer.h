@@ -8,6 +8,7 @@
 ******************************************************************/
 #ifndef SPRITE_RENDERER_H
 #define SPRITE_RENDERER_H
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -17,21 +18,101 @@
 #include "shader.h"
 
 
+// Per-sprite data as stored in the instance buffer
+struct SpriteInstance {
+    glm::vec2 Position;
+    glm::vec2 Size;
+    glm::vec3 Color;
+    float     Rotation; // radians, around the sprite's center
+    glm::vec4 Region;   // texture coordinates of the image: <u0, v0, u1, v1>
+    int       Texture;  // texture unit within the batch
+    int       Visible;  // 0 hides the sprite (see SpriteBuffer)
+};
+
+// Most sprites a single instanced draw takes
+const unsigned int MAX_BATCH_SPRITES = 4096;
+// Distinct textures a single instanced draw can sample from (texture units 0..N-1)
+const unsigned int MAX_BATCH_TEXTURES = 8;
+
+
+// SpriteBuffer is a persistent instance buffer for sprites that
+// hardly ever change, such as the bricks of a level. Its sprites are
+// uploaded once by SpriteRenderer::Upload; after that a sprite is
+// hidden or shown by patching its visibility in place, a 4-byte
+// buffer update, and SpriteRenderer::Draw draws the whole buffer with
+// one instanced call however many sprites it holds.
+class SpriteBuffer
+{
+public:
+    // constructor/destructor
+    SpriteBuffer();
+    ~SpriteBuffer();
+    // removes all sprites (Upload again afterwards)
+    void         Clear();
+    // appends a sprite, returning its index; up to MAX_BATCH_TEXTURES distinct textures per buffer
+    unsigned int Add(const Texture2D& texture, glm::vec2 position, glm::vec2 size, float rotate = 0.0f, glm::vec3 color = glm::vec3(1.0f), bool visible = true);
+    // shows or hides a sprite; once uploaded, only that sprite's visibility is sent to the GPU
+    void         SetVisible(unsigned int index, bool visible);
+    // number of sprites, and how many of them are visible
+    unsigned int Count() const { return static_cast<unsigned int>(this->sprites.size()); }
+    unsigned int VisibleCount() const { return this->visibleCount; }
+private:
+    friend class SpriteRenderer;
+    std::vector<SpriteInstance> sprites;
+    unsigned int                textures[MAX_BATCH_TEXTURES];
+    unsigned int                textureCount;
+    unsigned int                visibleCount;
+    // GPU copy, created by SpriteRenderer::Upload (0 until then)
+    unsigned int                VAO, instanceVBO;
+    // the buffer owns GL objects
+    SpriteBuffer(const SpriteBuffer&) = delete;
+    SpriteBuffer& operator=(const SpriteBuffer&) = delete;
+};
+
+
+// SpriteRenderer draws textured quads in batches. Between Begin and
+// Flush, Submit only appends the sprite to a streaming instance
+// buffer; Flush then draws all of them, in submission order, with
+// one glDrawArraysInstanced per run of up to MAX_BATCH_TEXTURES
+// distinct textures; sprites whose images share an atlas page count
+// as one texture. The model transform is built in the vertex shader.
+// Outside of a batch, Submit draws the sprite right away.
 class SpriteRenderer
 {
 public:
+    // draw statistics since the last ResetStats
+    unsigned int DrawCalls, Sprites;
     // Constructor (inits shaders/shapes)
     SpriteRenderer(Shader& shader);
     // Destructor
     ~SpriteRenderer();
-    // Renders a defined quad textured with given sprite
-    void DrawSprite(Texture2D& texture, glm::vec2 position, glm::vec2 size = glm::vec2(10.0f, 10.0f), float rotate = 0.0f, glm::vec3 color = glm::vec3(1.0f));
+    // starts collecting sprites
+    void Begin();
+    // queues a quad textured with given sprite; rotate is in degrees
+    void Submit(const Texture2D& texture, glm::vec2 position, glm::vec2 size = glm::vec2(10.0f, 10.0f), float rotate = 0.0f, glm::vec3 color = glm::vec3(1.0f));
+    // draws everything queued since Begin and ends the batch; must be called before drawing anything else
+    void Flush();
+    // uploads all sprites of a buffer
+    void Upload(SpriteBuffer& buffer);
+    // draws an uploaded buffer in one call; within a batch, the sprites queued so far are drawn first
+    void Draw(const SpriteBuffer& buffer);
+    // resets DrawCalls and Sprites
+    void ResetStats() { this->DrawCalls = this->Sprites = 0; }
 private:
     // Render state
-    Shader       shader;
-    unsigned int quadVAO;
+    Shader                      shader;
+    unsigned int                quadVAO, quadVBO, instanceVBO;
+    // batch state
+    bool                        batching;
+    std::vector<SpriteInstance> instances;
+    unsigned int                textures[MAX_BATCH_TEXTURES];
+    unsigned int                textureCount;
     // Initializes and configures the quad's buffer and vertex attributes
     void initRenderData();
+    // sets up a vertex array drawing the quad once per SpriteInstance of the given buffer
+    void initVertexArray(unsigned int VAO, unsigned int instanceBuffer);
+    // issues the draw for the queued sprites
+    void drawBatch();
 };
 
-#endif
\ No newline at end of file
+#endif
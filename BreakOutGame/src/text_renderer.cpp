@@ -6,6 +6,7 @@
 ** Creative Commons, either version 4 of the License, or (at your
 ** option) any later version.
 ******************************************************************/
+#include <algorithm>
 #include <iostream>
 
 #include <glm/gtc/matrix_transform.hpp>
@@ -13,45 +14,114 @@
 #include FT_FREETYPE_H
 
 #include "text_renderer.h"
+#include "file_system.h"
 #include "resource_manager.h"
 
 
-TextRenderer::TextRenderer(unsigned int width, unsigned int height)
+// glyph atlas layout: rows of glyphs, each surrounded by empty texels so linear filtering never picks up a neighbour
+static const unsigned int GLYPH_ATLAS_WIDTH = 512;
+static const unsigned int GLYPH_PADDING = 1;
+// floats per vertex: <vec2 pos, vec2 tex>
+static const unsigned int TEXT_VERTEX_SIZE = 4;
+
+
+// uploads vertices into a buffer, growing it when they don't fit
+static void uploadVertices(unsigned int buffer, unsigned int& capacity, const std::vector<float>& vertices)
+{
+    unsigned int vertexCount = static_cast<unsigned int>(vertices.size() / TEXT_VERTEX_SIZE);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    if (vertexCount > capacity)
+    {
+        capacity = std::max(vertexCount, 2 * capacity);
+        glBufferData(GL_ARRAY_BUFFER, capacity * TEXT_VERTEX_SIZE * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(float), vertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+TextObject::TextObject()
+    : x(0.0f), y(0.0f), scale(1.0f), color(1.0f), dirty(true), fontVersion(0), VAO(0), VBO(0), vertexCapacity(0), vertexCount(0)
+{
+
+}
+
+TextObject::~TextObject()
+{
+    if (this->VAO)
+    {
+        glDeleteVertexArrays(1, &this->VAO);
+        glDeleteBuffers(1, &this->VBO);
+    }
+}
+
+void TextObject::SetText(const std::string& text)
+{
+    if (text == this->text)
+        return;
+    this->text = text;
+    this->dirty = true;
+}
+
+void TextObject::SetPosition(float x, float y, float scale)
+{
+    if (x == this->x && y == this->y && scale == this->scale)
+        return;
+    this->x = x;
+    this->y = y;
+    this->scale = scale;
+    this->dirty = true;
+}
+
+void TextObject::SetColor(glm::vec3 color)
+{
+    this->color = color;
+}
+
+TextRenderer::TextRenderer()
+    : DrawCalls(0), Layouts(0), vertexCapacity(0), capHeight(0), fontVersion(0)
 {
     // load and configure shader
-    this->TextShader = ResourceManager::LoadShader("C:/cz/BO/BreakOutGame/BreakOutGame/src/shaders/text_2d.vs", "C:/cz/BO/BreakOutGame/BreakOutGame/src/shaders/text_2d.fs", nullptr, "text");
-    this->TextShader.SetMatrix4("projection", glm::ortho(0.0f, static_cast<float>(width), static_cast<float>(height), 0.0f), true);
-    this->TextShader.SetInteger("text", 0);
-    // configure VAO/VBO for texture quads
+    this->TextShader = ResourceManager::LoadShader("shaders/text_2d.vs", "shaders/text_2d.fs", nullptr, "text");
+    this->TextShader.SetInteger("text", 0, true);
+    this->textColorUniform = this->TextShader.GetUniform<glm::vec3>("textColor");
+    // configure VAO/VBO for texture quads; the VBO is sized by RenderText
     glGenVertexArrays(1, &this->VAO);
     glGenBuffers(1, &this->VBO);
-    glBindVertexArray(this->VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    initVertexArray(this->VAO, this->VBO);
 }
 
 void TextRenderer::Load(std::string font, unsigned int fontSize)
+{
+    GlyphAtlasImage image;
+    Rasterize(font, fontSize, image);
+    this->Upload(image);
+}
+
+void TextRenderer::Rasterize(const std::string& font, unsigned int fontSize, GlyphAtlasImage& image)
 {
     // first clear the previously loaded Characters
-    this->Characters.clear();
-    // then initialize and load the FreeType library
+    std::fill(image.Characters, image.Characters + TEXT_GLYPH_COUNT, Character());
+    image.Pixels.clear();
+    // then initialize and load the FreeType library (one per call, so calls on different threads don't share it)
     FT_Library ft;
     if (FT_Init_FreeType(&ft)) // all functions return a value different than 0 whenever an error occurred
         std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
-    // load font as face
+    // load font as face; FreeType reads from the view until the face is done
+    FileView fontData;
+    std::vector<char> storage;
+    FileSystem::ViewFile(font, fontData, storage);
     FT_Face face;
-    if (FT_New_Face(ft, font.c_str(), 0, &face))
+    if (FT_New_Memory_Face(ft, reinterpret_cast<const FT_Byte*>(fontData.Data), static_cast<FT_Long>(fontData.Size), 0, &face))
         std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
     // set size to load glyphs as
     FT_Set_Pixel_Sizes(face, 0, fontSize);
-    // disable byte-alignment restriction
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    // then for the first 128 ASCII characters, pre-load/compile their characters and store them
-    for (GLubyte c = 0; c < 128; c++) // lol see what I did there 
+    // then for the first 128 ASCII characters, pre-load/compile their characters and
+    // copy their bitmaps into rows of the atlas image, which grows downwards as needed
+    std::vector<unsigned char>& pixels = image.Pixels;
+    glm::ivec2 position[TEXT_GLYPH_COUNT] = {}; // glyphs that fail to load keep an empty region at the origin
+    unsigned int x = GLYPH_PADDING, y = GLYPH_PADDING, rowHeight = 0;
+    for (unsigned int c = 0; c < TEXT_GLYPH_COUNT; c++) // lol see what I did there 
     {
         // load character glyph 
         if (FT_Load_Char(face, c, FT_LOAD_RENDER))
@@ -59,82 +129,169 @@ void TextRenderer::Load(std::string font, unsigned int fontSize)
             std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
             continue;
         }
-        // generate texture
-        unsigned int texture;
-        glGenTextures(1, &texture);
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glTexImage2D(
-            GL_TEXTURE_2D,
-            0,
-            GL_RED,
-            face->glyph->bitmap.width,
-            face->glyph->bitmap.rows,
-            0,
-            GL_RED,
-            GL_UNSIGNED_BYTE,
-            face->glyph->bitmap.buffer
-        );
-        // set texture options
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        // now store character for later use
+        const FT_Bitmap& bitmap = face->glyph->bitmap;
+        if (bitmap.width + 2 * GLYPH_PADDING > GLYPH_ATLAS_WIDTH)
+        {
+            // it would overrun even an empty row; the glyph keeps its advance but draws nothing
+            std::cout << "ERROR::FREETYPE: Glyph " << c << " is too wide for the glyph atlas" << std::endl;
+            Character character = {
+                glm::vec4(0.0f),
+                glm::ivec2(0, 0),
+                glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
+                static_cast<unsigned int>(face->glyph->advance.x)
+            };
+            image.Characters[c] = character;
+            continue;
+        }
+        if (x + bitmap.width + GLYPH_PADDING > GLYPH_ATLAS_WIDTH)
+        {
+            // start a new row
+            x = GLYPH_PADDING;
+            y += rowHeight + GLYPH_PADDING;
+            rowHeight = 0;
+        }
+        pixels.resize(std::max<size_t>(pixels.size(), (y + bitmap.rows + GLYPH_PADDING) * GLYPH_ATLAS_WIDTH), 0);
+        for (unsigned int row = 0; row < bitmap.rows; ++row)
+        {
+            const unsigned char* source = bitmap.buffer + row * bitmap.pitch;
+            std::copy(source, source + bitmap.width, &pixels[(y + row) * GLYPH_ATLAS_WIDTH + x]);
+        }
+        position[c] = glm::ivec2(x, y);
+        x += bitmap.width + GLYPH_PADDING;
+        rowHeight = std::max(rowHeight, bitmap.rows);
+
+        // now store character for later use (its region is filled in once the atlas height is known)
         Character character = {
-            texture,
-            glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
+            glm::vec4(0.0f),
+            glm::ivec2(bitmap.width, bitmap.rows),
             glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-            face->glyph->advance.x
+            static_cast<unsigned int>(face->glyph->advance.x)
         };
-        Characters.insert(std::pair<char, Character>(c, character));
+        image.Characters[c] = character;
     }
-    glBindTexture(GL_TEXTURE_2D, 0);
     // destroy FreeType once we're finished
     FT_Done_Face(face);
     FT_Done_FreeType(ft);
+
+    image.Width = GLYPH_ATLAS_WIDTH;
+    image.Height = std::max<unsigned int>(static_cast<unsigned int>(pixels.size() / GLYPH_ATLAS_WIDTH), 1);
+    pixels.resize(image.Height * GLYPH_ATLAS_WIDTH, 0);
+    for (unsigned int c = 0; c < TEXT_GLYPH_COUNT; c++)
+    {
+        Character& ch = image.Characters[c];
+        ch.Region = glm::vec4(
+            static_cast<float>(position[c].x) / image.Width,
+            static_cast<float>(position[c].y) / image.Height,
+            static_cast<float>(position[c].x + ch.Size.x) / image.Width,
+            static_cast<float>(position[c].y + ch.Size.y) / image.Height);
+    }
 }
 
-void TextRenderer::RenderText(std::string text, float x, float y, float scale, glm::vec3 color)
+void TextRenderer::Upload(const GlyphAtlasImage& image)
 {
-    // activate corresponding render state	
-    this->TextShader.Use();
-    this->TextShader.SetVector3f("textColor", color);
-    glActiveTexture(GL_TEXTURE0);
-    glBindVertexArray(this->VAO);
+    // rows are 512 bytes, so the default unpack alignment holds
+    this->Atlas.Internal_Format = GL_RED;
+    this->Atlas.Image_Format = GL_RED;
+    this->Atlas.Wrap_S = GL_CLAMP_TO_EDGE;
+    this->Atlas.Wrap_T = GL_CLAMP_TO_EDGE;
+    this->Atlas.Filter_Min = GL_LINEAR;
+    this->Atlas.Filter_Max = GL_LINEAR;
+    this->Atlas.Generate(image.Width, image.Height, const_cast<unsigned char*>(image.Pixels.data()));
+    std::copy(image.Characters, image.Characters + TEXT_GLYPH_COUNT, this->Characters);
+    this->capHeight = this->Characters['H'].Bearing.y;
+    ++this->fontVersion;
+}
 
-    // iterate through all characters
-    std::string::const_iterator c;
-    for (c = text.begin(); c != text.end(); c++)
+void TextRenderer::RenderText(const std::string& text, float x, float y, float scale, glm::vec3 color)
+{
+    unsigned int vertexCount = this->layout(text, x, y, scale);
+    if (vertexCount == 0)
+        return;
+    uploadVertices(this->VBO, this->vertexCapacity, this->vertices);
+    this->draw(this->VAO, vertexCount, color);
+}
+
+void TextRenderer::Draw(TextObject& text)
+{
+    if (text.dirty || text.fontVersion != this->fontVersion)
     {
-        Character ch = Characters[*c];
+        text.vertexCount = this->layout(text.text, text.x, text.y, text.scale);
+        if (text.vertexCount > 0)
+        {
+            if (!text.VAO)
+            {
+                glGenVertexArrays(1, &text.VAO);
+                glGenBuffers(1, &text.VBO);
+                initVertexArray(text.VAO, text.VBO);
+            }
+            uploadVertices(text.VBO, text.vertexCapacity, this->vertices);
+        }
+        text.dirty = false;
+        text.fontVersion = this->fontVersion;
+    }
+    if (text.vertexCount > 0)
+        this->draw(text.VAO, text.vertexCount, text.color);
+}
+
+unsigned int TextRenderer::layout(const std::string& text, float x, float y, float scale)
+{
+    ++this->Layouts;
+    // build the quads of the whole string
+    this->vertices.clear();
+    for (char c : text)
+    {
+        unsigned int code = static_cast<unsigned char>(c);
+        if (code >= TEXT_GLYPH_COUNT)
+            continue;
+        const Character& ch = this->Characters[code];
 
         float xpos = x + ch.Bearing.x * scale;
-        float ypos = y + (this->Characters['H'].Bearing.y - ch.Bearing.y) * scale;
+        float ypos = y + (this->capHeight - ch.Bearing.y) * scale;
 
         float w = ch.Size.x * scale;
         float h = ch.Size.y * scale;
-        // update VBO for each character
-        float vertices[6][4] = {
-            { xpos,     ypos + h,   0.0f, 1.0f },
-            { xpos + w, ypos,       1.0f, 0.0f },
-            { xpos,     ypos,       0.0f, 0.0f },
-
-            { xpos,     ypos + h,   0.0f, 1.0f },
-            { xpos + w, ypos + h,   1.0f, 1.0f },
-            { xpos + w, ypos,       1.0f, 0.0f }
-        };
-        // render glyph texture over quad
-        glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-        // update content of VBO memory
-        glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // be sure to use glBufferSubData and not glBufferData
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        // render quad
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        // glyphs without pixels (spaces) only move the cursor
+        if (ch.Size.x > 0 && ch.Size.y > 0)
+        {
+            const glm::vec4& uv = ch.Region;
+            float quad[6][TEXT_VERTEX_SIZE] = {
+                { xpos,     ypos + h,   uv.x, uv.w },
+                { xpos + w, ypos,       uv.z, uv.y },
+                { xpos,     ypos,       uv.x, uv.y },
+
+                { xpos,     ypos + h,   uv.x, uv.w },
+                { xpos + w, ypos + h,   uv.z, uv.w },
+                { xpos + w, ypos,       uv.z, uv.y }
+            };
+            this->vertices.insert(this->vertices.end(), &quad[0][0], &quad[0][0] + 6 * TEXT_VERTEX_SIZE);
+        }
         // now advance cursors for next glyph
         x += (ch.Advance >> 6) * scale; // bitshift by 6 to get value in pixels (1/64th times 2^6 = 64)
     }
+    return static_cast<unsigned int>(this->vertices.size() / TEXT_VERTEX_SIZE);
+}
+
+void TextRenderer::draw(unsigned int vertexArray, unsigned int vertexCount, glm::vec3 color)
+{
+    // activate corresponding render state	
+    this->TextShader.Use();
+    this->textColorUniform.Set(color);
+    glActiveTexture(GL_TEXTURE0);
+    this->Atlas.Bind();
+    glBindVertexArray(vertexArray);
+    // render all quads
+    glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+    ++this->DrawCalls;
     glBindVertexArray(0);
     glBindTexture(GL_TEXTURE_2D, 0);
-}
\ No newline at end of file
+}
+
+void TextRenderer::initVertexArray(unsigned int vertexArray, unsigned int buffer)
+{
+    glBindVertexArray(vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, TEXT_VERTEX_SIZE * sizeof(float), 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
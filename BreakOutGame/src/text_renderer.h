@@ -9,7 +9,8 @@
 #ifndef TEXT_RENDERER_H
 #define TEXT_RENDERER_H
 
-#include <map>
+#include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -20,32 +21,102 @@
 
 /// Holds all state information relevant to a character as loaded using FreeType
 struct Character {
-    unsigned int TextureID; // ID handle of the glyph texture
+    glm::vec4    Region;    // part of the glyph atlas holding the glyph: <u0, v0, u1, v1>
     glm::ivec2   Size;      // size of glyph
     glm::ivec2   Bearing;   // offset from baseline to left/top of glyph
     unsigned int Advance;   // horizontal offset to advance to next glyph
 };
 
 
+// glyphs are loaded for the ASCII range; other characters are skipped
+const unsigned int TEXT_GLYPH_COUNT = 128;
+
+
+// The glyphs of a font rasterized by FreeType into a single-channel
+// atlas image, ready to upload; made without a GL context
+struct GlyphAtlasImage {
+    Character                  Characters[TEXT_GLYPH_COUNT]; // regions already refer to the image
+    std::vector<unsigned char> Pixels;
+    unsigned int               Width, Height;
+};
+
+
+// A string kept on the GPU between frames. Layout only re-runs when its
+// text, position or scale (or the renderer's font) changed since it was
+// last drawn; otherwise drawing it is a single draw call with no CPU work.
+// GL objects are created on first draw, so it can be set up without a context.
+class TextObject
+{
+public:
+    // constructor/destructor
+    TextObject();
+    ~TextObject();
+    // setters; each only marks the object dirty when the value actually changes
+    void SetText(const std::string& text);
+    void SetPosition(float x, float y, float scale = 1.0f);
+    void SetColor(glm::vec3 color); // a uniform, never needs a new layout
+    const std::string& GetText() const { return this->text; }
+private:
+    // the object owns GL objects
+    TextObject(const TextObject&) = delete;
+    TextObject& operator=(const TextObject&) = delete;
+    // state
+    std::string  text;
+    float        x, y, scale;
+    glm::vec3    color;
+    bool         dirty;
+    unsigned int fontVersion; // renderer font the geometry was laid out with
+    // render state
+    unsigned int VAO, VBO;
+    unsigned int vertexCapacity, vertexCount;
+    friend class TextRenderer;
+};
+
+
 // A renderer class for rendering text displayed by a font loaded using the 
 // FreeType library. A single font is loaded, processed into a list of Character
-// items for later rendering.
+// items for later rendering. All glyphs are packed into one single-channel
+// atlas texture, so a string is built into one vertex buffer and drawn with
+// a single draw call.
 class TextRenderer
 {
 public:
-    // holds a list of pre-compiled Characters
-    std::map<char, Character> Characters;
+    // holds the pre-compiled Characters, indexed by code point
+    Character Characters[TEXT_GLYPH_COUNT];
+    // single-channel texture holding every glyph
+    Texture2D Atlas;
     // shader used for text rendering
     Shader TextShader;
+    // draw calls issued since this was last reset
+    unsigned int DrawCalls;
+    // strings laid out since this was last reset (every RenderText, only changed TextObjects)
+    unsigned int Layouts;
     // constructor
-    TextRenderer(unsigned int width, unsigned int height);
+    TextRenderer();
     // pre-compiles a list of characters from the given font
     void Load(std::string font, unsigned int fontSize);
+    // rasterizes the glyphs of a font; needs no GL context, so it can run on any thread
+    static void Rasterize(const std::string& font, unsigned int fontSize, GlyphAtlasImage& image);
+    // uploads rasterized glyphs as the renderer's font (what Load does after Rasterize)
+    void Upload(const GlyphAtlasImage& image);
     // renders a string of text using the precompiled list of characters
-    void RenderText(std::string text, float x, float y, float scale, glm::vec3 color = glm::vec3(1.0f));
+    void RenderText(const std::string& text, float x, float y, float scale, glm::vec3 color = glm::vec3(1.0f));
+    // draws a retained string, laying it out again first if it changed
+    void Draw(TextObject& text);
 private:
     // render state
     unsigned int VAO, VBO;
+    unsigned int vertexCapacity; // vertices the VBO can hold
+    std::vector<float> vertices; // quads of the string being rendered, reused between calls
+    int capHeight; // bearing of 'H', lines up the tops of capitals with y
+    unsigned int fontVersion; // bumped by Load, so retained strings know to lay out again
+    // builds the quads of a string into vertices; returns the vertex count
+    unsigned int layout(const std::string& text, float x, float y, float scale);
+    // binds the shader, color and atlas, then draws the given vertex array
+    void draw(unsigned int vertexArray, unsigned int vertexCount, glm::vec3 color);
+    // sets up a vertex array reading text vertices <vec2 pos, vec2 tex> from the buffer
+    static void initVertexArray(unsigned int vertexArray, unsigned int buffer);
+    Uniform<glm::vec3> textColorUniform;
 };
 
 #endif 
\ No newline at end of file
@@ -6,24 +6,50 @@
 ** Creative Commons, either version 4 of the License, or (at your
 ** option) any later version.
 ******************************************************************/
+#include <algorithm>
 #include <iostream>
 
 #include "texture.h"
 
 
 Texture2D::Texture2D()
-    : Width(0), Height(0), Internal_Format(GL_RGB), Image_Format(GL_RGB), Wrap_S(GL_REPEAT), Wrap_T(GL_REPEAT), Filter_Min(GL_LINEAR), Filter_Max(GL_LINEAR)
+    : ID(0), Width(0), Height(0), Internal_Format(GL_RGB), Image_Format(GL_RGB), Levels(1), Wrap_S(GL_REPEAT), Wrap_T(GL_REPEAT), Filter_Min(GL_LINEAR), Filter_Max(GL_LINEAR), Region(0.0f, 0.0f, 1.0f, 1.0f), OwnsTexture(true)
 {
-    glGenTextures(1, &this->ID);
+
 }
 
 void Texture2D::Generate(unsigned int width, unsigned int height, unsigned char* data)
 {
     this->Width = width;
     this->Height = height;
-    // create Texture
+    // create Texture (lazily, so texture-holding objects can exist without a GL context)
+    if (this->ID == 0)
+        glGenTextures(1, &this->ID);
     glBindTexture(GL_TEXTURE_2D, this->ID);
-    glTexImage2D(GL_TEXTURE_2D, 0, this->Internal_Format, width, height, 0, this->Image_Format, GL_UNSIGNED_BYTE, data);
+    // rows are tightly packed, which an RGB level with an odd width isn't at the default 4-byte alignment
+    GLint alignment;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (unsigned int level = 0; level < this->Levels; ++level)
+    {
+        unsigned int levelWidth = std::max(width >> level, 1u), levelHeight = std::max(height >> level, 1u);
+        unsigned int size;
+        if (this->Internal_Format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+        {
+            size = ImageSize(this->Internal_Format, levelWidth, levelHeight);
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, this->Internal_Format, levelWidth, levelHeight, 0, size, data);
+        }
+        else
+        {
+            size = ImageSize(this->Image_Format, levelWidth, levelHeight);
+            glTexImage2D(GL_TEXTURE_2D, level, this->Internal_Format, levelWidth, levelHeight, 0, this->Image_Format, GL_UNSIGNED_BYTE, data);
+        }
+        if (data)
+            data += size;
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+    if (this->Levels > 1)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, this->Levels - 1);
     // set Texture wrap and filter modes
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, this->Wrap_S);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, this->Wrap_T);
@@ -33,6 +59,21 @@ void Texture2D::Generate(unsigned int width, unsigned int height, unsigned char*
     glBindTexture(GL_TEXTURE_2D, 0);
 }
 
+unsigned int Texture2D::ImageSize(unsigned int format, unsigned int width, unsigned int height)
+{
+    switch (format)
+    {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        return (width + 3) / 4 * ((height + 3) / 4) * 8; // 8 bytes per 4x4 block
+    case GL_RED:
+        return width * height;
+    case GL_RGBA:
+        return width * height * 4;
+    default:
+        return width * height * 3;
+    }
+}
+
 void Texture2D::Bind() const
 {
     glBindTexture(GL_TEXTURE_2D, this->ID);
@@ -10,6 +10,12 @@
 #define TEXTURE_H
 
 #include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// BC1 (DXT1) blocks; from EXT_texture_compression_s3tc, which the GL loader doesn't cover
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
 
 // Texture2D is able to store and configure a texture in OpenGL.
 // It also hosts utility functions for easy management.
@@ -23,15 +29,22 @@ public:
     // texture Format
     unsigned int Internal_Format; // format of texture object
     unsigned int Image_Format; // format of loaded image
+    unsigned int Levels; // mip levels in the data given to Generate, largest first
     // texture configuration
     unsigned int Wrap_S; // wrapping mode on S axis
     unsigned int Wrap_T; // wrapping mode on T axis
     unsigned int Filter_Min; // filtering mode if texture pixels < screen pixels
     unsigned int Filter_Max; // filtering mode if texture pixels > screen pixels
-    // constructor (sets default texture modes)
+    // part of the texture object holding the image: <u0, v0, u1, v1>; all of it unless the image lives in an atlas
+    glm::vec4 Region;
+    // whether the texture object is this texture's own; atlas regions share their page's, which the atlas owns
+    bool OwnsTexture;
+    // constructor (sets default texture modes; the GL texture object is created by Generate)
     Texture2D();
-    // generates texture from image data
+    // generates texture from image data; a compressed Internal_Format takes the data as is
     void Generate(unsigned int width, unsigned int height, unsigned char* data);
+    // size in bytes of a width x height image of the given format
+    static unsigned int ImageSize(unsigned int format, unsigned int width, unsigned int height);
     // binds the texture as the current active GL_TEXTURE_2D texture object
     void Bind() const;
 };
@@ -0,0 +1,227 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include "texture_atlas.h"
+
+#include <algorithm>
+#include <iostream>
+
+
+// a horizontal stretch of the skyline: everything below y is taken between x and x + width
+struct SkylineSegment {
+    unsigned int X, Y, Width;
+};
+
+// where an image went
+struct AtlasPlacement {
+    unsigned int Image;
+    unsigned int X, Y; // top-left corner of the bordered cell
+};
+
+static unsigned int alignUp(unsigned int value, unsigned int alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// appends the next mip level of a width x height RGBA image, averaging every 2x2 block
+static void appendHalf(std::vector<unsigned char>& pixels, size_t level, unsigned int width, unsigned int height)
+{
+    unsigned int halfWidth = width / 2, halfHeight = height / 2;
+    size_t half = pixels.size();
+    pixels.resize(half + static_cast<size_t>(halfWidth) * halfHeight * 4);
+    for (unsigned int y = 0; y < halfHeight; ++y)
+        for (unsigned int x = 0; x < halfWidth; ++x)
+            for (unsigned int c = 0; c < 4; ++c)
+            {
+                const unsigned char* row0 = &pixels[level + (static_cast<size_t>(2 * y) * width + 2 * x) * 4 + c];
+                const unsigned char* row1 = row0 + static_cast<size_t>(width) * 4;
+                pixels[half + (static_cast<size_t>(y) * halfWidth + x) * 4 + c] = static_cast<unsigned char>((row0[0] + row0[4] + row1[0] + row1[4] + 2) / 4);
+            }
+}
+
+// finds the lowest (then leftmost) spot on the skyline for a width x height cell; false if it doesn't fit the page
+static bool findSpot(const std::vector<SkylineSegment>& skyline, unsigned int width, unsigned int height, unsigned int pageSize, unsigned int& bestX, unsigned int& bestY)
+{
+    bool found = false;
+    for (size_t i = 0; i < skyline.size(); ++i)
+    {
+        unsigned int x = skyline[i].X;
+        if (x + width > pageSize)
+            break;
+        // the cell rests on the highest segment it spans
+        unsigned int y = 0;
+        for (size_t j = i; j < skyline.size() && skyline[j].X < x + width; ++j)
+            y = std::max(y, skyline[j].Y);
+        if (y + height > pageSize)
+            continue;
+        if (!found || y < bestY)
+        {
+            bestX = x;
+            bestY = y;
+            found = true;
+        }
+    }
+    return found;
+}
+
+// raises the skyline under a cell placed at x, y
+static void place(std::vector<SkylineSegment>& skyline, unsigned int x, unsigned int y, unsigned int width, unsigned int height)
+{
+    SkylineSegment top = { x, y + height, width };
+    std::vector<SkylineSegment> raised;
+    for (const SkylineSegment& segment : skyline)
+    {
+        unsigned int end = segment.X + segment.Width;
+        if (end <= x || segment.X >= x + width)
+        {
+            raised.push_back(segment);
+            continue;
+        }
+        // keep the parts sticking out on either side of the cell
+        if (segment.X < x)
+            raised.push_back({ segment.X, segment.Y, x - segment.X });
+        if (segment.X <= x)
+            raised.push_back(top);
+        if (end > x + width)
+            raised.push_back({ x + width, segment.Y, end - (x + width) });
+    }
+    // merge neighbours of equal height
+    skyline.clear();
+    for (const SkylineSegment& segment : raised)
+    {
+        if (!skyline.empty() && skyline.back().Y == segment.Y)
+            skyline.back().Width += segment.Width;
+        else
+            skyline.push_back(segment);
+    }
+}
+
+TextureAtlas::TextureAtlas(unsigned int maxPageSize, unsigned int border, unsigned int mipLevels)
+    : maxPageSize(maxPageSize), border(border), mipLevels(std::max(mipLevels, 1u))
+{
+
+}
+
+void TextureAtlas::Add(const std::string& name, unsigned int width, unsigned int height, const unsigned char* pixels)
+{
+    if (!pixels || width == 0 || height == 0)
+    {
+        std::cout << "ERROR::ATLAS: No image data for " << name << std::endl;
+        return;
+    }
+    AtlasImage image;
+    image.Name = name;
+    image.Width = width;
+    image.Height = height;
+    image.Pixels.assign(pixels, pixels + width * height * 4);
+    this->pending.push_back(image);
+}
+
+void TextureAtlas::Build(std::map<std::string, Texture2D>& textures)
+{
+    // tallest images first keeps the skyline flat
+    std::vector<unsigned int> order(this->pending.size());
+    for (unsigned int i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [this](unsigned int a, unsigned int b) {
+        return this->pending[a].Height > this->pending[b].Height;
+    });
+
+    // every level down to the last keeps cells apart and at least border texels of border
+    unsigned int scale = 1u << (this->mipLevels - 1);
+    unsigned int alignment = std::max(ATLAS_ALIGNMENT, scale);
+    unsigned int border = this->border * scale;
+    size_t next = 0;
+    while (next < order.size())
+    {
+        // fill one page with as many of the remaining images as fit
+        std::vector<SkylineSegment> skyline(1, SkylineSegment{ 0, 0, this->maxPageSize });
+        std::vector<AtlasPlacement> placements;
+        std::vector<unsigned int> leftOver;
+        unsigned int pageWidth = 0, pageHeight = 0;
+        for (; next < order.size(); ++next)
+        {
+            const AtlasImage& image = this->pending[order[next]];
+            unsigned int width = alignUp(image.Width + 2 * border, alignment);
+            unsigned int height = alignUp(image.Height + 2 * border, alignment);
+            unsigned int x = 0, y = 0;
+            if (!findSpot(skyline, width, height, this->maxPageSize, x, y))
+            {
+                if (placements.empty())
+                    std::cout << "ERROR::ATLAS: " << image.Name << " does not fit an atlas page" << std::endl;
+                else
+                    leftOver.push_back(order[next]);
+                continue;
+            }
+            place(skyline, x, y, width, height);
+            placements.push_back({ order[next], x, y });
+            pageWidth = std::max(pageWidth, x + width);
+            pageHeight = std::max(pageHeight, y + height);
+        }
+        // images that didn't fit go to the next page
+        order.erase(order.begin(), order.begin() + next);
+        order.insert(order.begin(), leftOver.begin(), leftOver.end());
+        next = 0;
+        if (placements.empty())
+            continue;
+
+        // copy every image into its cell, wrapping around its edges into the border
+        std::vector<unsigned char> pixels(pageWidth * pageHeight * 4, 0);
+        for (const AtlasPlacement& placement : placements)
+        {
+            const AtlasImage& image = this->pending[placement.Image];
+            unsigned int cellWidth = image.Width + 2 * border, cellHeight = image.Height + 2 * border;
+            for (unsigned int y = 0; y < cellHeight; ++y)
+            {
+                unsigned int sourceY = (y + image.Height - border % image.Height) % image.Height;
+                for (unsigned int x = 0; x < cellWidth; ++x)
+                {
+                    unsigned int sourceX = (x + image.Width - border % image.Width) % image.Width;
+                    const unsigned char* source = &image.Pixels[(sourceY * image.Width + sourceX) * 4];
+                    unsigned char* target = &pixels[((placement.Y + y) * pageWidth + placement.X + x) * 4];
+                    std::copy(source, source + 4, target);
+                }
+            }
+        }
+        // page sizes are multiples of the alignment, so every level halves exactly
+        size_t level = 0;
+        for (unsigned int i = 1; i < this->mipLevels; ++i)
+        {
+            size_t size = pixels.size() - level;
+            appendHalf(pixels, level, pageWidth >> (i - 1), pageHeight >> (i - 1));
+            level += size;
+        }
+        Texture2D page;
+        page.Internal_Format = GL_RGBA;
+        page.Image_Format = GL_RGBA;
+        page.Wrap_S = GL_CLAMP_TO_EDGE;
+        page.Wrap_T = GL_CLAMP_TO_EDGE;
+        page.Levels = this->mipLevels;
+        if (this->mipLevels > 1)
+            page.Filter_Min = GL_LINEAR_MIPMAP_LINEAR;
+        page.Generate(pageWidth, pageHeight, pixels.data());
+        this->Pages.push_back(page);
+
+        // the textures handed out share the page's GL texture and only differ in region
+        for (const AtlasPlacement& placement : placements)
+        {
+            const AtlasImage& image = this->pending[placement.Image];
+            Texture2D texture = page;
+            texture.Width = image.Width;
+            texture.Height = image.Height;
+            texture.OwnsTexture = false;
+            texture.Region = glm::vec4(
+                static_cast<float>(placement.X + border) / pageWidth,
+                static_cast<float>(placement.Y + border) / pageHeight,
+                static_cast<float>(placement.X + border + image.Width) / pageWidth,
+                static_cast<float>(placement.Y + border + image.Height) / pageHeight);
+            textures[image.Name] = texture;
+        }
+    }
+    this->pending.clear();
+}
@@ -0,0 +1,58 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "texture.h"
+
+
+// An image waiting to be packed, as 8-bit RGBA
+struct AtlasImage {
+    std::string                Name;
+    unsigned int               Width, Height;
+    std::vector<unsigned char> Pixels;
+};
+
+// Placements (and page sizes) are multiples of this many texels
+const unsigned int ATLAS_ALIGNMENT = 4;
+
+
+// TextureAtlas packs many small images into a few large textures
+// (pages), so sprites using different images can still share one
+// texture binding. Images are placed with a skyline packer, each
+// surrounded by a border of texels wrapped around from its opposite
+// edge: linear filtering at the edges then reads exactly what it
+// would from a standalone GL_REPEAT texture, and never a neighbour.
+// Pages built with more than one mip level stay that way at every
+// level: cells are aligned to 2^(levels - 1) texels, so halving never
+// mixes two cells, and the border is scaled up so it is still border
+// texels wide on the smallest level.
+class TextureAtlas
+{
+public:
+    // atlas pages, created by Build
+    std::vector<Texture2D> Pages;
+    // constructor
+    TextureAtlas(unsigned int maxPageSize = 2048, unsigned int border = 2, unsigned int mipLevels = 1);
+    // queues an RGBA image for the next Build
+    void Add(const std::string& name, unsigned int width, unsigned int height, const unsigned char* pixels);
+    // packs all queued images into new pages; stores for each one a texture referring to its region of a page
+    void Build(std::map<std::string, Texture2D>& textures);
+private:
+    unsigned int            maxPageSize;
+    unsigned int            border;
+    unsigned int            mipLevels;
+    std::vector<AtlasImage> pending;
+};
+
+#endif